@@ -0,0 +1,33 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| Benchmark.h
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Kernel micro benchmarks, run once at boot when the kernel
+|               is compiled with '-D BENCHMARK'. Results are printed to the
+|               console in CPU cycles(time-stamp counter).
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <Module.h>
+
+/*-------------------------------------------------------------------------
+| Get benchmark module
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the benchmark module.
+|
+| NOTES:           Needs to be loaded before the usermode module, which
+|                  never returns.
+\------------------------------------------------------------------------*/
+Module* Benchmark_getModule(void);
+
+#endif
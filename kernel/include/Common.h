@@ -17,18 +17,24 @@
 #ifndef COMMON_H
 #define COMMON_H
 
-/* User stack size and virtual address(just below page directory recursive-map) */
-#define USER_STACK_SIZE       4096
+/* User stack size and virtual address(just below page directory recursive-map), grows down on demand */
+#define USER_STACK_SIZE       4096     /* Mapped when the process is created */
+#define USER_STACK_MAX_SIZE   0x800000 /* 8MB reserved, including the guard page */
 #define USER_STACK_TOP_VADDR  0xFFC00000 - 0x1000
 #define USER_STACK_BASE_VADDR (USER_STACK_TOP_VADDR - USER_STACK_SIZE)
+#define USER_STACK_GUARD_VADDR (USER_STACK_TOP_VADDR - USER_STACK_MAX_SIZE) /* Never mapped, catches overflows */
 
 /* User heap, 2GB-4GB(ish) virtual address*/
 #define USER_HEAP_BASE_VADDR 0x80000000
-#define USER_HEAP_TOP_VADDR  USER_STACK_BASE_VADDR
+#define USER_HEAP_TOP_VADDR  USER_STACK_GUARD_VADDR
 
 /* User code */
 #define USER_CODE_BASE_VADDR  0x40000000
 
+/* User memory mappings(mmap), between code and heap */
+#define USER_MMAP_BASE_VADDR  0x60000000
+#define USER_MMAP_TOP_VADDR   USER_HEAP_BASE_VADDR
+
 /* Kernel heap, 512MB-1GB virtual address*/
 #define KERNEL_HEAP_BASE_VADDR 0x20000000
 #define KERNEL_HEAP_TOP_VADDR  0x40000000
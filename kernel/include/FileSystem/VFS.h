@@ -54,6 +54,7 @@ struct VFS {
     u32int     (*write)     (VFSNode* self, u32int offset, u32int count, const char* buffer);
     VFSNode*   (*readDir)   (VFSNode* self, u32int index);
     VFSNode*   (*findDir)   (VFSNode* self, const char* path);
+    void*      (*getFrame)  (VFSNode* self, u32int offset);
 
 };
 
@@ -213,6 +214,43 @@ VFSNode* VFS_findDir(VFSNode* dir, const char* path);
 \------------------------------------------------------------------------*/
 u32int VFS_read(VFSNode* self, u32int offset, u32int count, char* buffer);
 
+/*-------------------------------------------------------------------------
+| Read executable image
+|--------------------------------------------------------------------------
+| DESCRIPTION:    Reads from a file backing a process image.
+|
+| PARAM:          'self'    the file to read from
+|                 'offset'  starts reading from this offset
+|                 'count'   number of bytes to read
+|                 'buffer'  buffer to store read bytes
+|
+| RETURN:         'u32int'  the number of read bytes
+|
+| NOTES:          The file does not need to be open, images are read only
+|                 and shared by every process running them.
+|                 Unlike VFS_read, exactly "count" bytes are written to
+|                 "buffer"(no null terminator).
+\------------------------------------------------------------------------*/
+u32int VFS_readImage(VFSNode* self, u32int offset, u32int count, char* buffer);
+
+/*-------------------------------------------------------------------------
+| Get image frame
+|--------------------------------------------------------------------------
+| DESCRIPTION:    Returns the physical frame holding the page of file data
+|                 that starts at "offset", so it can be mapped directly
+|                 instead of being copied.
+|
+| PARAM:          'self'    the file
+|                 'offset'  page aligned offset into the file
+|
+| RETURN:         'void*'   frame address, NULL if the file system does not
+|                 keep that page in memory on a page boundary
+|
+| NOTES:          The frame belongs to the file system, it must be mapped
+|                 read only and never freed.
+\------------------------------------------------------------------------*/
+void* VFS_getImageFrame(VFSNode* self, u32int offset);
+
 /*-------------------------------------------------------------------------
 | Write file
 |--------------------------------------------------------------------------
@@ -8,6 +8,9 @@
 |--------------------------------------------------------------------------
 |
 | DESCRIPTION:  Bit array data structure implementation.
+|                   - Operates on 32-bit words
+|                   - Optional summary level, one bit per word which is
+|                     set when all 32 bits of the word are set
 |
 | AUTHOR:       Ali Ersenal, aliersenal@gmail.com
 \------------------------------------------------------------------------*/
@@ -18,6 +21,11 @@
 
 #include <Common.h>
 
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define BITMAP_NOT_FOUND 0xFFFFFFFF
+
 /*=======================================================
     STRUCT
 =========================================================*/
@@ -25,17 +33,26 @@ typedef struct Bitmap Bitmap;
 
 struct Bitmap {
 
-    void*  start; /* Bitmap start address */
-    u32int length; /* Length of bitmap in bytes */
+    void*   start;   /* Bitmap start address */
+    u32int  length;  /* Length of bitmap in bytes, multiple of 4 */
+    u32int* summary; /* Full word summary, NULL if not used */
+    u32int  hint;    /* No clear bit exists in words below this word index */
 
 };
 
 /*=======================================================
     FUNCTION
 =========================================================*/
-void Bitmap_setBit(Bitmap* self, u32int index);
-void Bitmap_clearBit(Bitmap* self, u32int index);
-bool Bitmap_isSet(Bitmap* self, u32int index);
-void Bitmap_toggle(Bitmap* self, u32int index);
-void Bitmap_init(Bitmap* self, void* start, u32int length);
-#endif
\ No newline at end of file
+void   Bitmap_setBit(Bitmap* self, u32int index);
+void   Bitmap_clearBit(Bitmap* self, u32int index);
+bool   Bitmap_isSet(Bitmap* self, u32int index);
+void   Bitmap_toggle(Bitmap* self, u32int index);
+u32int Bitmap_setRange(Bitmap* self, u32int index, u32int count);
+u32int Bitmap_clearRange(Bitmap* self, u32int index, u32int count);
+u32int Bitmap_countSet(Bitmap* self, u32int index, u32int count);
+u32int Bitmap_findFirstClear(Bitmap* self);
+u32int Bitmap_setFirstClear(Bitmap* self, u32int count, u32int* indices);
+u32int Bitmap_getSummaryLength(u32int length);
+void   Bitmap_initSummary(Bitmap* self, void* summary);
+void   Bitmap_init(Bitmap* self, void* start, u32int length);
+#endif
@@ -0,0 +1,65 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| LZ.h
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  LZ77 family compressor, favours speed over ratio.
+|                   - Byte oriented, similar to LZ4 block format
+|                   - Inputs up to 64KB
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#ifndef LZ_H
+#define LZ_H
+
+#include <Common.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define LZ_MAX_LENGTH      0xFFFF
+#define LZ_HASH_BITS       12
+#define LZ_WORKSPACE_SIZE  ((1 << LZ_HASH_BITS) * sizeof(u16int)) /* Bytes needed by LZ_compress */
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/*-------------------------------------------------------------------------
+| Compress
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Compresses a block of memory.
+|
+| PARAM:           "source"       data to compress
+|                  "length"       length of data, at most LZ_MAX_LENGTH
+|                  "destination"  receives the compressed data
+|                  "capacity"     size of destination in bytes
+|                  "workspace"    LZ_WORKSPACE_SIZE bytes of scratch memory
+|
+| RETURN:          'u32int' compressed length, 0 if it does not fit in
+|                  "capacity"
+\------------------------------------------------------------------------*/
+u32int LZ_compress(const u8int* source, u32int length, u8int* destination, u32int capacity, void* workspace);
+
+/*-------------------------------------------------------------------------
+| Decompress
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Decompresses a block made by LZ_compress.
+|
+| PARAM:           "source"       compressed data
+|                  "length"       length of compressed data
+|                  "destination"  receives the original data
+|                  "capacity"     size of destination in bytes
+|
+| RETURN:          'u32int' original length, 0 if the block is corrupt or
+|                  does not fit in "capacity"
+\------------------------------------------------------------------------*/
+u32int LZ_decompress(const u8int* source, u32int length, u8int* destination, u32int capacity);
+
+#endif
@@ -39,6 +39,8 @@ struct Stack {
 
 void  Stack_push(Stack* self, void* item);
 void* Stack_pop(Stack* self);
+void  Stack_pushMany(Stack* self, void** items, u32int count);
+void  Stack_popMany(Stack* self, void** items, u32int count);
 void* Stack_peek(Stack* self);
 void  Stack_init(Stack* self, void* start, u32int length);
 #endif
\ No newline at end of file
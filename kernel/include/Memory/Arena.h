@@ -0,0 +1,98 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| Arena.h
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Bump allocator for short lived kernel buffers. Memory is
+|               handed out from page chunks and given back all at once.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <Common.h>
+
+/*=======================================================
+    STRUCT
+=========================================================*/
+typedef struct Arena      Arena;
+typedef struct ArenaMark  ArenaMark;
+typedef struct ArenaChunk ArenaChunk;
+
+/* A zeroed arena is empty and ready to use */
+struct Arena {
+
+    ArenaChunk* chunk; /* Chunk being filled, earlier chunks are linked behind it */
+    u32int      used;  /* Bytes used in "chunk" */
+
+};
+
+/* Position in an arena, see Arena_begin. A zeroed mark is the start of the arena */
+struct ArenaMark {
+
+    ArenaChunk* chunk;
+    u32int      used;
+
+};
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/*-------------------------------------------------------------------------
+| Begin scope
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the current position of an arena, everything
+|                  allocated after it is freed by Arena_reset.
+|
+| PARAM:           "arena"  the arena
+|
+| RETURN:          'ArenaMark' the position
+\------------------------------------------------------------------------*/
+ArenaMark Arena_begin(Arena* arena);
+
+/*-------------------------------------------------------------------------
+| Arena allocation
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates "bytes" from an arena, 8 byte aligned. There
+|                  is no free, see Arena_reset.
+|
+| PARAM:           "arena"  the arena
+|                  "bytes"  number of bytes to allocate
+|
+| RETURN:          void*   pointer to allocated space(not cleared)
+\------------------------------------------------------------------------*/
+void* Arena_alloc(Arena* arena, u32int bytes);
+
+/*-------------------------------------------------------------------------
+| Reset arena
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Frees everything allocated since "mark" was taken.
+|                  Chunks no longer needed go back to a pool shared by
+|                  every arena.
+|
+| PARAM:           "arena"  the arena
+|                  "mark"   position returned by Arena_begin, a zeroed mark
+|                           empties the arena
+\------------------------------------------------------------------------*/
+void Arena_reset(Arena* arena, ArenaMark mark);
+
+/*-------------------------------------------------------------------------
+| Get scratch arena
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the scratch arena of the current process, it is
+|                  emptied when the process' system call returns. Before
+|                  the first process runs a boot arena is returned.
+|
+| RETURN:          'Arena*' the arena
+\------------------------------------------------------------------------*/
+Arena* Arena_getScratch(void);
+
+#endif
@@ -39,6 +39,54 @@ void* BitmapPMM_allocateFrame(void);
 \------------------------------------------------------------------------*/
 void BitmapPMM_freeFrame(void* b);
 
+/*-------------------------------------------------------------------------
+| Allocate frames
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates "n" frames and stores their addresses in "frames".
+|
+| PARAM:           "n"       number of frames to allocate
+|                  "frames"  array of at least "n" entries to be filled
+|
+| RETURN:          bool  TRUE if all "n" frames were allocated
+|
+| NOTES:           Nothing is allocated if less than "n" frames are free.
+\------------------------------------------------------------------------*/
+bool BitmapPMM_allocateFrames(u32int n, void** frames);
+
+/*-------------------------------------------------------------------------
+| Free frames
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Deallocates "n" frames.
+|
+| PARAM:           "n"       number of frames to deallocate
+|                  "frames"  addresses of frames to be deallocated
+\------------------------------------------------------------------------*/
+void BitmapPMM_freeFrames(u32int n, void** frames);
+
+/*-------------------------------------------------------------------------
+| Allocate block
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates (2^order) contiguous frames.
+|
+| PARAM:           "order"  block order, 0..PMM_MAX_ORDER
+|
+| RETURN:          void*  allocated block address
+|
+| NOTES:           Returns NULL if out of physical memory.
+|                  Searches the bitmap for a free, block size aligned run of frames.
+\------------------------------------------------------------------------*/
+void* BitmapPMM_allocateBlock(u32int order);
+
+/*-------------------------------------------------------------------------
+| Free block
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Deallocates a block of (2^order) frames.
+|
+| PARAM:           "b"      the address of block to be deallocated
+|                  "order"  the order it was allocated with
+\------------------------------------------------------------------------*/
+void BitmapPMM_freeBlock(void* b, u32int order);
+
 /*-------------------------------------------------------------------------
 | Physical memory initialisation
 |--------------------------------------------------------------------------
@@ -0,0 +1,111 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| BuddyPMM.h (implements PhysicalMemory)
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Binary buddy physical memory manager implementation.
+|               Hands out blocks of (2^order) contiguous frames.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#ifndef BUDDY_PMM
+#define BUDDY_PMM
+
+#include <Multiboot.h>
+#include <Memory/PhysicalMemory.h>
+
+/*-------------------------------------------------------------------------
+| Allocate frame
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates and returns a frame address(4096 bytes).
+|
+| RETURN:          void*  allocated frame address
+|
+| NOTES:           Returns NULL if out of physical memory.
+\------------------------------------------------------------------------*/
+void* BuddyPMM_allocateFrame(void);
+
+/*-------------------------------------------------------------------------
+| Free frame
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Deallocates the frame at address "b".
+|
+| PARAM:           "b"  the address of frame to be deallocated
+\------------------------------------------------------------------------*/
+void BuddyPMM_freeFrame(void* b);
+
+/*-------------------------------------------------------------------------
+| Allocate frames
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates "n" frames and stores their addresses in "frames".
+|
+| PARAM:           "n"       number of frames to allocate
+|                  "frames"  array of at least "n" entries to be filled
+|
+| RETURN:          bool  TRUE if all "n" frames were allocated
+|
+| NOTES:           Nothing is allocated if less than "n" frames are free.
+\------------------------------------------------------------------------*/
+bool BuddyPMM_allocateFrames(u32int n, void** frames);
+
+/*-------------------------------------------------------------------------
+| Free frames
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Deallocates "n" frames.
+|
+| PARAM:           "n"       number of frames to deallocate
+|                  "frames"  addresses of frames to be deallocated
+\------------------------------------------------------------------------*/
+void BuddyPMM_freeFrames(u32int n, void** frames);
+
+/*-------------------------------------------------------------------------
+| Allocate block
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates (2^order) contiguous frames. Splits a larger
+|                  free block if no block of the requested order is free.
+|
+| PARAM:           "order"  block order, 0..PMM_MAX_ORDER
+|
+| RETURN:          void*  allocated block address
+|
+| NOTES:           Returns NULL if out of physical memory.
+\------------------------------------------------------------------------*/
+void* BuddyPMM_allocateBlock(u32int order);
+
+/*-------------------------------------------------------------------------
+| Free block
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Deallocates a block and merges it with its buddy for as
+|                  long as the buddy is free too.
+|
+| PARAM:           "b"      the address of block to be deallocated
+|                  "order"  the order it was allocated with
+\------------------------------------------------------------------------*/
+void BuddyPMM_freeBlock(void* b, u32int order);
+
+/*-------------------------------------------------------------------------
+| Physical memory initialisation
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Sets up physical memory.
+|
+\------------------------------------------------------------------------*/
+void BuddyPMM_init(void);
+
+/*-------------------------------------------------------------------------
+| Get current memory information
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns a structure containing physical memory info.
+|
+| PARAM:           'buf' memory info structure to be filled with the info.
+|
+| RETURN:          'PhysicalMemoryInfo*' pointer to filled memory info structure.
+\------------------------------------------------------------------------*/
+PhysicalMemoryInfo*  BuddyPMM_getInfo(PhysicalMemoryInfo* buf);
+
+#endif
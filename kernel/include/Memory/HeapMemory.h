@@ -20,6 +20,13 @@
 #include <Module.h>
 #include <Common.h>
 
+/*=======================================================
+    DEFINE
+=========================================================*/
+
+/* Owners for HeapMemory_setOwner, any other value is a process id */
+#define HEAP_OWNER_RUNNING 0xFFFFFFFF /* Process running when the allocation is made */
+#define HEAP_OWNER_KERNEL  0          /* Kernel wide caches and tables, never reported as leaks(KERNEL_PID) */
 
 /*=======================================================
     INTERFACE
@@ -97,9 +104,51 @@ void*   HeapMemory_expand(ptrdiff_t size);
 |                  space by "size" bytes. "size" needs to be page aligned.
 |
 | PARAM:           "size"  Page aligned number of bytes
+|
+| NOTES:           Expanding only reserves the range, each page is backed by
+|                  a zeroed frame when it is first touched(page fault).
 \------------------------------------------------------------------------*/
 void* HeapMemory_expandUser(ptrdiff_t size);
 
+/*-------------------------------------------------------------------------
+| Print heap profile
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Prints the usage of every slab cache, then live and peak
+|                  kernel heap usage, a histogram of allocation sizes, the
+|                  call sites holding the most memory and the blocks leaked
+|                  by destroyed processes.
+|
+| NOTES:           Everything but the slab caches needs the kernel to be
+|                  compiled with '-D HEAP_PROFILE', every allocation then
+|                  carries a header naming its call site and owner.
+\------------------------------------------------------------------------*/
+void HeapMemory_printProfile(void);
+
+/*-------------------------------------------------------------------------
+| Report leaks
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Marks the blocks still owned by a destroyed process as
+|                  leaked and prints where they were allocated. Does
+|                  nothing unless compiled with '-D HEAP_PROFILE'.
+|
+| PARAM:           "pid"  id of the destroyed process
+\------------------------------------------------------------------------*/
+void HeapMemory_reportLeaks(u32int pid);
+
+/*-------------------------------------------------------------------------
+| Set allocation owner
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Charges the following allocations to "owner" in the
+|                  heap profile, until it is set back. A reallocated block
+|                  keeps the owner it was allocated with.
+|
+| PARAM:           "owner"  a process id, HEAP_OWNER_KERNEL or
+|                           HEAP_OWNER_RUNNING(default)
+|
+| RETURN:          'u32int' the previous owner, to restore it with
+\------------------------------------------------------------------------*/
+u32int HeapMemory_setOwner(u32int owner);
+
 
 /*-------------------------------------------------------------------------
 | Get kernel heap manager module
@@ -25,6 +25,9 @@
 =========================================================*/
 #define FRAME_SIZE 4096
 
+/* Largest contiguous block order, a block of order n is (2^n) frames. 10 = 4MB */
+#define PMM_MAX_ORDER 10
+
 /*=======================================================
     STRUCT
 =========================================================*/
@@ -35,6 +38,17 @@ struct PhysicalMemoryInfo {
     u32int totalMemory; /* Total physical memory in bytes */
     u32int totalFrames; /* Number of page frames */
     u32int freeFrames; /* Number of free(not in use) page frames */
+    u32int freeBlocks[PMM_MAX_ORDER + 1]; /* Number of free blocks of each order */
+
+};
+
+typedef struct ZeroPoolInfo ZeroPoolInfo;
+
+struct ZeroPoolInfo {
+
+    u32int frames; /* Number of pre-zeroed frames in the pool */
+    u32int hits;   /* Zeroed frame requests served from the pool */
+    u32int misses; /* Zeroed frame requests that had to be zeroed on the spot */
 
 };
 
@@ -84,10 +98,154 @@ extern void* (*PhysicalMemory_allocateFrame) (void);
 \------------------------------------------------------------------------*/
 extern void  (*PhysicalMemory_freeFrame) (void* frame);
 
+/*-------------------------------------------------------------------------
+| Allocate frames
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates "n" frames(not necessarily contiguous) in one go
+|                  and stores their addresses in "frames".
+|
+| PARAM:           "n"       number of frames to allocate
+|                  "frames"  array of at least "n" entries to be filled
+|
+| RETURN:          bool  TRUE if all "n" frames were allocated
+|
+| NOTES:           All or nothing, if there are less than "n" free frames
+|                  nothing is allocated and FALSE is returned.
+\------------------------------------------------------------------------*/
+extern bool  (*PhysicalMemory_allocateFrames) (u32int n, void** frames);
+
+/*-------------------------------------------------------------------------
+| Free frames
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Deallocates the "n" frames whose addresses are in "frames".
+|
+| PARAM:           "n"       number of frames to deallocate
+|                  "frames"  addresses of frames to be deallocated
+\------------------------------------------------------------------------*/
+extern void  (*PhysicalMemory_freeFrames) (u32int n, void** frames);
+
+/*-------------------------------------------------------------------------
+| Allocate block
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates (2^order) physically contiguous frames and
+|                  returns the address of the first frame.
+|
+| PARAM:           "order"  block order, 0..PMM_MAX_ORDER
+|
+| RETURN:          void*  allocated block address, aligned to the block size
+|
+| NOTES:           Returns NULL if no block of that size is available.
+\------------------------------------------------------------------------*/
+extern void* (*PhysicalMemory_allocateBlock) (u32int order);
+
+/*-------------------------------------------------------------------------
+| Free block
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Deallocates a block previously returned by
+|                  PhysicalMemory_allocateBlock.
+|
+| PARAM:           "block"  the address of block to be deallocated
+|                  "order"  the order it was allocated with
+\------------------------------------------------------------------------*/
+extern void  (*PhysicalMemory_freeBlock) (void* block, u32int order);
+
 /*=======================================================
     FUNCTION
 =========================================================*/
 
+/*-------------------------------------------------------------------------
+| Allocate zeroed frame
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates and returns a frame whose contents are zero.
+|                  Frames come from the pre-zeroed pool when possible,
+|                  otherwise a frame is allocated and zeroed on the spot.
+|
+| RETURN:          void*  allocated frame address
+|
+| NOTES:           Returns NULL if out of physical memory.
+|                  Needs paging to be enabled.
+\------------------------------------------------------------------------*/
+void* PhysicalMemory_allocateZeroedFrame(void);
+
+/*-------------------------------------------------------------------------
+| Allocate zeroed frames
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Takes up to "n" frames from the pre-zeroed pool.
+|
+| PARAM:           "n"       number of frames wanted
+|                  "frames"  array of at least "n" entries to be filled
+|
+| RETURN:          u32int  number of frames taken from the pool
+|
+| NOTES:           The caller allocates and zeroes the remaining frames,
+|                  which are counted as pool misses.
+\------------------------------------------------------------------------*/
+u32int PhysicalMemory_allocateZeroedFrames(u32int n, void** frames);
+
+/*-------------------------------------------------------------------------
+| Refill zeroed frame pool
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Zeroes one free frame and adds it to the pool.
+|
+| RETURN:          bool  FALSE if there was nothing to do(pool is full or
+|                  memory is low)
+|
+| NOTES:           Called by the idle process, runs with interrupts enabled.
+\------------------------------------------------------------------------*/
+bool PhysicalMemory_refillZeroedPool(void);
+
+/*-------------------------------------------------------------------------
+| Get zeroed frame pool information
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the pool size and its hit/miss counters.
+|
+| PARAM:           'buf' pool info structure to be filled with the info.
+|
+| RETURN:          'ZeroPoolInfo*' pointer to filled pool info structure.
+\------------------------------------------------------------------------*/
+ZeroPoolInfo* PhysicalMemory_getZeroPoolInfo(ZeroPoolInfo* buf);
+
+/*-------------------------------------------------------------------------
+| Print memory info
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Prints free frames and the pre-zeroed pool's size, hits
+|                  and misses(see 'mem' shell command).
+\------------------------------------------------------------------------*/
+void PhysicalMemory_printInfo(void);
+
+/*-------------------------------------------------------------------------
+| Add frame reference
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Records one more mapping of a frame, used when a frame
+|                  is shared between address spaces(copy on write).
+|
+| PARAM:           "frame"  the frame address
+\------------------------------------------------------------------------*/
+void PhysicalMemory_addFrameReference(void* frame);
+
+/*-------------------------------------------------------------------------
+| Drop frame reference
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Removes one mapping of a frame.
+|
+| PARAM:           "frame"  the frame address
+|
+| RETURN:          bool  TRUE if that was the last reference, the caller
+|                  should then free the frame
+\------------------------------------------------------------------------*/
+bool PhysicalMemory_dropFrameReference(void* frame);
+
+/*-------------------------------------------------------------------------
+| Is frame shared
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Checks whether a frame is mapped more than once.
+|
+| PARAM:           "frame"  the frame address
+|
+| RETURN:          bool  TRUE if there is more than one reference
+\------------------------------------------------------------------------*/
+bool PhysicalMemory_isFrameShared(void* frame);
+
 /*-------------------------------------------------------------------------
 | Get PMM module
 |--------------------------------------------------------------------------
@@ -0,0 +1,109 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| Slab.h
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Object caches for fixed size kernel objects, built on top
+|               of the kernel heap.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <Common.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define CACHE_LINE_SIZE 64 /* Default object alignment */
+
+/*=======================================================
+    STRUCT
+=========================================================*/
+typedef struct SlabCache SlabCache;
+typedef struct SlabInfo  SlabInfo;
+
+struct SlabInfo {
+
+    const char* name;
+    u32int objectSize;    /* Bytes per object, padding included */
+    u32int slabs;         /* Blocks taken from the kernel heap */
+    u32int totalObjects;  /* Objects the slabs hold */
+    u32int activeObjects; /* Objects handed out */
+    u32int allocations;   /* Number of Slab_alloc calls */
+
+};
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/*-------------------------------------------------------------------------
+| Create cache
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Creates a cache of objects of the same size. Memory is
+|                  taken from the kernel heap a slab at a time and is kept
+|                  by the cache, freed objects are reused.
+|
+| PARAM:           "name"   name of the cache, shown in statistics
+|                  "size"   object size in bytes
+|                  "align"  object alignment, a power of two, 0 aligns
+|                           objects to a cache line
+|
+| RETURN:          'SlabCache*' the new cache
+\------------------------------------------------------------------------*/
+SlabCache* Slab_createCache(const char* name, u32int size, u32int align);
+
+/*-------------------------------------------------------------------------
+| Allocate object
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Takes an object from a cache and clears it.
+|
+| PARAM:           "cache"  the cache to allocate from
+|
+| RETURN:          void*   the object, NULL if the heap is out of memory
+\------------------------------------------------------------------------*/
+void* Slab_alloc(SlabCache* cache);
+
+/*-------------------------------------------------------------------------
+| Free object
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Gives an object back to the cache it came from.
+|
+| PARAM:           "cache"   the cache the object was allocated from
+|                  "object"  the object
+\------------------------------------------------------------------------*/
+void Slab_free(SlabCache* cache, void* object);
+
+/*-------------------------------------------------------------------------
+| Get cache information
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Fills a buffer with the usage statistics of a cache.
+|
+| PARAM:           "cache"  the cache
+|                  "buf"    buffer to fill
+|
+| RETURN:          'SlabInfo*' "buf"
+\------------------------------------------------------------------------*/
+SlabInfo* Slab_getInfo(SlabCache* cache, SlabInfo* buf);
+
+/*-------------------------------------------------------------------------
+| Get cache
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns a cache by its position in the list of every
+|                  cache, most recently created first.
+|
+| PARAM:           "index"  position in the list
+|
+| RETURN:          'SlabCache*' the cache, NULL if "index" is past the end
+\------------------------------------------------------------------------*/
+SlabCache* Slab_getCache(u32int index);
+
+#endif
@@ -0,0 +1,74 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| Swap.h
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Compressed in-memory store for pages evicted from user
+|               address spaces(see VirtualMemory_reclaim).
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include <Common.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define SWAP_NO_SLOT 0xFFFFFFFF
+#define SWAP_MAX_SLOTS (1 << 20) /* A slot number has to fit in a page table entry */
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/*-------------------------------------------------------------------------
+| Store page
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Compresses a page into the kernel heap.
+|
+| PARAM:           "page"  virtual address of the page to store
+|
+| RETURN:          'u32int' slot number, SWAP_NO_SLOT if the page does not
+|                  compress well enough to be worth storing
+\------------------------------------------------------------------------*/
+u32int Swap_store(const void* page);
+
+/*-------------------------------------------------------------------------
+| Load page
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Decompresses a stored page. The slot stays in use.
+|
+| PARAM:           "slot"  slot number returned by Swap_store
+|                  "page"  virtual address of the page to fill
+\------------------------------------------------------------------------*/
+void Swap_load(u32int slot, void* page);
+
+/*-------------------------------------------------------------------------
+| Duplicate slot
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Makes a second copy of a stored page.
+|
+| PARAM:           "slot"  slot number returned by Swap_store
+|
+| RETURN:          'u32int' slot number of the copy
+\------------------------------------------------------------------------*/
+u32int Swap_duplicate(u32int slot);
+
+/*-------------------------------------------------------------------------
+| Free slot
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Frees a stored page.
+|
+| PARAM:           "slot"  slot number returned by Swap_store
+\------------------------------------------------------------------------*/
+void Swap_free(u32int slot);
+
+#endif
@@ -0,0 +1,77 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| TLSF.h (implements HeapMemory)
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Two-Level Segregated Fit heap manager, malloc and free run
+|               in bounded time(no list walks, no loops over block sizes).
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#ifndef TLSF_H
+#define TLSF_H
+
+#include <Module.h>
+#include <Common.h>
+
+/*-------------------------------------------------------------------------
+| Heap allocation
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates "bytes" number of bytes of space in heap
+|                  and returns the allocated address.
+|
+| PARAM:           "bytes"  number of bytes to allocate
+|
+| RETURN:          void*   pointer to allocated space
+|
+| NOTES:           Constant time unless the heap has to grow, which maps
+|                  new pages through HeapMemory_expand.
+\------------------------------------------------------------------------*/
+void* TLSF_malloc(size_t bytes);
+
+/*-------------------------------------------------------------------------
+| Heap reallocation
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Reallocates the given memory block to a new block of
+|                  size "bytes".
+|
+| PARAM:           "oldmem"   pointer to old memory block
+|                  "bytes"    new size of memory block in bytes
+|
+| RETURN:          void*   pointer to reallocated space
+|
+\------------------------------------------------------------------------*/
+void* TLSF_realloc(void* oldmem, size_t bytes);
+
+/*-------------------------------------------------------------------------
+| Heap clear allocation
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Allocates an array of "numberOfElements" elements and
+|                  sets all bits as zero. Each element has "elementSize"
+|                  length.
+|
+| PARAM:           "numberOfElements" number of elements to be allocated
+|                  "elementSize"      size of an element in bytes
+|
+| RETURN:          void*   pointer to cleared and allocated space
+|
+\------------------------------------------------------------------------*/
+void* TLSF_calloc(size_t numberOfElements, size_t elementSize);
+
+/*-------------------------------------------------------------------------
+| Heap free
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Deallocates the specified memory block, merging it with
+|                  free neighbours. Constant time.
+|
+| PARAM:           "mem"  pointer to memory block
+\------------------------------------------------------------------------*/
+void  TLSF_free(void* mem);
+
+#endif
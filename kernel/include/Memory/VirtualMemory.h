@@ -26,6 +26,15 @@
 #define MODE_USER   1
 
 #define TEMPORARY_MAP_VADDR 0xF00000
+#define ZERO_POOL_MAP_VADDR 0xE00000 /* Used by PhysicalMemory to zero frames, 2 pages */
+#define COPY_ON_WRITE_VADDR 0xE02000 /* Used by the page fault handler to copy shared pages and swap pages in */
+#define RECLAIM_MAP_VADDR   0xE03000 /* Used by VirtualMemory_reclaim, 3 pages */
+
+#define LARGE_PAGE_SIZE 0x400000 /* 4MB, one page directory entry */
+
+/* Physical memory from address 0 is mapped here in every address space */
+#define DIRECT_MAP_VADDR 0x10000000
+#define DIRECT_MAP_SIZE  0x10000000 /* 256MB, frames above are reached with VirtualMemory_quickMap */
 
 /*=======================================================
     TYPE
@@ -66,6 +75,113 @@ void* VirtualMemory_mapPage(PageDirectory* dir, void* virtualAddr, void* physica
 \------------------------------------------------------------------------*/
 void VirtualMemory_unmapPage(PageDirectory* dir, void* virtualAddr);
 
+/*-------------------------------------------------------------------------
+| Map virtual address range
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Maps "count" consecutive pages starting at virtualAddr,
+|                  page i to physicalAddrs[i]. Cheaper than calling
+|                  VirtualMemory_mapPage for each page.
+|
+| PARAM:           "virtualAddr"    4KB aligned virtual address
+|                  "physicalAddrs"  4KB aligned physical addresses
+|                  "count"          number of pages
+|                  "mode"           0 - Kernel mode, 1 - User mode
+|
+| RETURN:          'void*' mapped virtual address
+\------------------------------------------------------------------------*/
+void* VirtualMemory_mapRange(PageDirectory* dir, void* virtualAddr, void** physicalAddrs, u32int count, bool mode);
+
+/*-------------------------------------------------------------------------
+| Unmap virtual address range
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Unmaps "count" consecutive pages starting at
+|                  virtualAddr. Pages which are not mapped are skipped.
+|                  Shared pages(zero page, ramdisk) are unmapped but their
+|                  frames are not returned, they must never be freed.
+|
+| PARAM:           "virtualAddr"    4KB aligned virtual address
+|                  "count"          number of pages
+|                  "physicalAddrs"  receives the physical address of every
+|                                   unmapped page that owned its frame,
+|                                   can be NULL
+|
+| RETURN:          'u32int' number of frames stored in "physicalAddrs"
+\------------------------------------------------------------------------*/
+u32int VirtualMemory_unmapRange(PageDirectory* dir, void* virtualAddr, u32int count, void** physicalAddrs);
+
+/*-------------------------------------------------------------------------
+| Has large pages
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Checks whether 4MB pages(CR4.PSE) are enabled.
+|
+| RETURN:         'bool' TRUE if 4MB pages are used for kernel mappings
+\------------------------------------------------------------------------*/
+bool VirtualMemory_hasLargePages(void);
+
+/*-------------------------------------------------------------------------
+| Is large page
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Checks whether a virtual address is mapped by a 4MB page
+|                  in the current page directory.
+|
+| PARAM:           "virtualAddr"   virtual address
+|
+| RETURN:         'bool' TRUE if mapped by a 4MB page
+\------------------------------------------------------------------------*/
+bool VirtualMemory_isLargePage(void* virtualAddr);
+
+/*-------------------------------------------------------------------------
+| Map memory
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Reserves a region of the current process' address space.
+|                  Anonymous regions are zeroed, file regions map the file
+|                  read only. Pages are mapped on first access.
+|
+| PARAM:           "addr"    preferred address, NULL to let the kernel pick
+|                  "length"  size in bytes, rounded up to pages
+|                  "file"    open file to map, NULL for anonymous memory
+|                  "offset"  page aligned offset into "file"
+|
+| RETURN:          'void*' start of the region, NULL on failure
+|
+| NOTES:           Regions lie between the code image and the user heap.
+|                  File system pages are shared, nothing is copied if the
+|                  file is stored on page boundaries(see VFS_getImageFrame).
+\------------------------------------------------------------------------*/
+void* VirtualMemory_mmap(void* addr, u32int length, VFSNode* file, u32int offset);
+
+/*-------------------------------------------------------------------------
+| Unmap memory
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Removes the pages in the range from the regions of the
+|                  current process. Frames it owns go back to the physical
+|                  memory manager.
+|
+| PARAM:           "addr"    page aligned start of the range
+|                  "length"  size in bytes, rounded up to pages
+|
+| RETURN:          'bool' FALSE if the range is invalid
+\------------------------------------------------------------------------*/
+bool VirtualMemory_munmap(void* addr, u32int length);
+
+/*-------------------------------------------------------------------------
+| Reclaim frames
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Frees frames of cold user pages. A clock hand walks the
+|                  user pages of every process, pages accessed since its
+|                  last pass get a second chance. Clean pages are dropped
+|                  and paged in again on demand, dirty pages are compressed
+|                  into the swap store(see Swap.h) and decompressed on the
+|                  next access.
+|
+| PARAM:           "frames"    number of frames wanted
+|                  "compress"  FALSE to only drop clean pages, storing
+|                              allocates from the kernel heap
+|
+| RETURN:          'u32int' number of frames freed
+\------------------------------------------------------------------------*/
+u32int VirtualMemory_reclaim(u32int frames, bool compress);
+
 /*-------------------------------------------------------------------------
 | Get physical address
 |--------------------------------------------------------------------------
@@ -77,6 +193,18 @@ void VirtualMemory_unmapPage(PageDirectory* dir, void* virtualAddr);
 \------------------------------------------------------------------------*/
 void* VirtualMemory_getPhysicalAddress(void* virtualAddr);
 
+/*-------------------------------------------------------------------------
+| Is mapped
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Checks whether a virtual address is mapped in the
+|                  current page directory.
+|
+| PARAM:           "virtualAddr"   4KB aligned virtual address
+|
+| RETURN:         'bool' TRUE if mapped
+\------------------------------------------------------------------------*/
+bool VirtualMemory_isMapped(void* virtualAddr);
+
 /*-------------------------------------------------------------------------
 | Quick map
 |--------------------------------------------------------------------------
@@ -99,6 +227,54 @@ void* VirtualMemory_quickMap(void* virtualAddr, void* physicalAddr);
 \------------------------------------------------------------------------*/
 void VirtualMemory_quickUnmap(void* virtualAddr);
 
+/*-------------------------------------------------------------------------
+| Physical to virtual address
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the direct map address of a physical address.
+|
+| PARAM:           "physicalAddr"   physical address
+|
+| RETURN:          'void*' virtual address, NULL if the physical address
+|                  is outside of the direct map
+\------------------------------------------------------------------------*/
+void* VirtualMemory_physToVirt(void* physicalAddr);
+
+/*-------------------------------------------------------------------------
+| Virtual to physical address
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the physical address of a direct map address.
+|
+| PARAM:           "virtualAddr"   address inside the direct map
+|
+| RETURN:          'void*' physical address
+\------------------------------------------------------------------------*/
+void* VirtualMemory_virtToPhys(void* virtualAddr);
+
+/*-------------------------------------------------------------------------
+| Map frame
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Makes a frame accessible. Frames in the direct map are
+|                  used as is, others are quick mapped to fallbackAddr.
+|
+| PARAM:           "physicalAddr"   4KB aligned physical address
+|                  "fallbackAddr"   4KB aligned virtual address used when
+|                                   the frame is not direct mapped
+|
+| RETURN:          'void*' virtual address of the frame
+|
+| NOTES:           Release with VirtualMemory_unmapFrame.
+\------------------------------------------------------------------------*/
+void* VirtualMemory_mapFrame(void* physicalAddr, void* fallbackAddr);
+
+/*-------------------------------------------------------------------------
+| Unmap frame
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Releases an address returned by VirtualMemory_mapFrame.
+|
+| PARAM:           "virtualAddr"   the address returned by mapFrame
+\------------------------------------------------------------------------*/
+void VirtualMemory_unmapFrame(void* virtualAddr);
+
 /*-------------------------------------------------------------------------
 | Get kernel directory
 |--------------------------------------------------------------------------
@@ -109,27 +285,30 @@ void VirtualMemory_quickUnmap(void* virtualAddr);
 PageDirectory* VirtualMemory_getKernelDir(void);
 
 /*-------------------------------------------------------------------------
-| Switch page directory
+| Get kernel heap limit
 |--------------------------------------------------------------------------
-| DESCRIPTION:     Changes the current page directory(address space) to specified one.
+| DESCRIPTION:     Returns the end of the kernel heap window. Page tables
+|                  up to it are allocated at boot and shared by every
+|                  address space.
 |
-| PARAM:           "dir"   the page directory to switch to
+| RETURN:         'void*' first virtual address past the kernel heap
 \------------------------------------------------------------------------*/
-void VirtualMemory_switchPageDir(PageDirectory* dir);
+void* VirtualMemory_getKernelHeapLimit(void);
 
 /*-------------------------------------------------------------------------
-| Map kernel
+| Switch page directory
 |--------------------------------------------------------------------------
-| DESCRIPTION:     Maps the OS kernel to specified process' page directory
+| DESCRIPTION:     Changes the current page directory(address space) to specified one.
 |
-| PARAM:           'process' the process to map to
+| PARAM:           "dir"   the page directory to switch to
 \------------------------------------------------------------------------*/
-void VirtualMemory_mapKernel(Process* process);
+void VirtualMemory_switchPageDir(PageDirectory* dir);
 
 /*-------------------------------------------------------------------------
 | Create page directory
 |--------------------------------------------------------------------------
 | DESCRIPTION:     Creates a new page directory for the specified process.
+|                  Kernel page tables are shared with the kernel directory.
 |
 | PARAM:           'process'   the process to create page directory for
 \------------------------------------------------------------------------*/
@@ -143,4 +322,41 @@ void VirtualMemory_createPageDirectory(Process* process);
 | PARAM:           'process'   the process to destroy page directory from
 \------------------------------------------------------------------------*/
 void VirtualMemory_destroyPageDirectory(Process* process);
+
+/*-------------------------------------------------------------------------
+| Reset page directory
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Frees every user page and page table of the specified
+|                  process. The directory itself is kept, ready to be
+|                  reused by a new process.
+|
+| PARAM:           'process'   the process to reset page directory of
+\------------------------------------------------------------------------*/
+void VirtualMemory_resetPageDirectory(Process* process);
+
+/*-------------------------------------------------------------------------
+| Release user page table
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Frees the pages of one user page table of the specified
+|                  process and the table itself. Lets a dead address space
+|                  be torn down a piece at a time.
+|
+| PARAM:           'process'   the process, must not be running
+|
+| RETURN:          bool  FALSE if the process had no user page tables left
+\------------------------------------------------------------------------*/
+bool VirtualMemory_releaseUserTable(Process* process);
+
+/*-------------------------------------------------------------------------
+| Clone address space
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Copies the user part of the current address space into
+|                  the specified process' page directory. Frames are not
+|                  copied, they are shared read only by both and copied
+|                  when either side writes to them.
+|
+| PARAM:           'process'   the process to clone into, its page directory
+|                              must be created and have the kernel mapped
+\------------------------------------------------------------------------*/
+void VirtualMemory_cloneAddressSpace(Process* process);
 #endif
\ No newline at end of file
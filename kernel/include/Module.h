@@ -37,6 +37,7 @@
 #define MODULE_PS2          110
 #define MODULE_VFS          111
 #define MODULE_USERMODE     112
+#define MODULE_BENCHMARK    113
 
 /*=======================================================
     STRUCT
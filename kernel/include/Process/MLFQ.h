@@ -0,0 +1,84 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| MLFQ.h (implements Scheduler)
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Multi-level feedback queue process scheduler implementation.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#ifndef MLFQ_H
+#define MLFQ_H
+
+#include <Process/ProcessManager.h>
+
+/*-------------------------------------------------------------------------
+| Add process
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Adds a new process to the highest queue its nice value
+|                  allows. The kernel process becomes the idle process, it
+|                  runs when no other process can and for at least a tick
+|                  every MLFQ_IDLE_PERIOD ticks.
+|
+| PARAM:           'process'  the process to add
+\------------------------------------------------------------------------*/
+void MLFQ_addProcess(Process* process);
+
+/*-------------------------------------------------------------------------
+| Remove process
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Removes a process from scheduler's process list.
+|
+| PARAM:           'process'  the process to remove
+\------------------------------------------------------------------------*/
+void MLFQ_removeProcess(Process* process);
+
+/*-------------------------------------------------------------------------
+| Get next process
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the first process that is not blocked in the
+|                  highest non empty queue, or the idle process if nothing
+|                  is runnable or its turn is due.
+|
+| RETURN:          'Process*' the next process
+\------------------------------------------------------------------------*/
+Process* MLFQ_getNextProcess(void);
+
+/*-------------------------------------------------------------------------
+| Get current process
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the current process.
+|
+| RETURN:          'Process*' the current process
+\------------------------------------------------------------------------*/
+Process* MLFQ_getCurrentProcess(void);
+
+/*-------------------------------------------------------------------------
+| Timer tick
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Charges a tick to the current process. A process that
+|                  uses up its quantum moves down a queue. Every
+|                  MLFQ_BOOST_PERIOD ticks all processes move back up.
+|
+| RETURN:          true    if the current process should be switched out
+|                  false   otherwise
+\------------------------------------------------------------------------*/
+bool MLFQ_tick(void);
+
+/*-------------------------------------------------------------------------
+| Boost process
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Moves a process to the highest queue its nice value
+|                  allows, with a fresh quantum.
+|
+| PARAM:           'process'  the process to boost
+\------------------------------------------------------------------------*/
+void MLFQ_boostProcess(Process* process);
+
+#endif
@@ -20,6 +20,7 @@
 #include <X86/IDT.h>
 #include <FileSystem/VFS.h>
 #include <Lib/ArrayList.h>
+#include <Memory/Arena.h>
 
 /*=======================================================
     DEFINE
@@ -39,6 +40,9 @@
 #define PROCESS_BLOCKED     4
 #define PROCESS_TERMINATED  5
 
+/* Highest nice value, see ProcessManager_nice */
+#define PROCESS_NICE_MAX    19
+
 /*=======================================================
     STRUCT
 =========================================================*/
@@ -56,8 +60,23 @@ struct Process {
     void*  userStackBase;
     void*  pageDir;
 
+    VFSNode* image;     /* Executable backing the code region, paged in on demand */
+    u32int   codePages; /* Size of code region starting at USER_CODE_BASE_VADDR */
+
     VFSNode* workingDirectory;
     ArrayList* fileNodes;
+    ArrayList* mappings; /* Regions made with mmap(see VirtualMemory_mmap), NULL if none */
+
+    /* Page fault events, not pages currently mapped(unmapping, reclaim and copy on write don't decrement them) */
+    u32int zeroFaults;    /* Read faults served with the shared zero page */
+    u32int privateFaults; /* Faults that gave the process a frame of its own, including zero page copies */
+
+    Arena scratch; /* Short lived kernel buffers, emptied when a system call returns(see Arena_getScratch) */
+
+    /* Scheduling, used by schedulers with priorities(see MLFQ.c) */
+    u32int priority; /* Queue of the process, 0 is the highest */
+    u32int ticks;    /* Timer ticks used of the current quantum */
+    u32int nice;     /* 0 to PROCESS_NICE_MAX, higher values cap the priority lower */
 
 };
 
@@ -95,6 +114,20 @@ void ProcessManager_killProcess(int exitCode);
 \------------------------------------------------------------------------*/
 Process* ProcessManager_spawnProcess(const char* binary);
 
+/*-------------------------------------------------------------------------
+| Fork process
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Creates a copy of the current process. User pages are
+|                  shared read only and copied when either process writes
+|                  to them.
+|
+| PARAM:           'regs' the current process' state when it made the call
+|
+| RETURN:          'Process*' the new(child) process, the child itself
+|                  returns 0 from the call
+\------------------------------------------------------------------------*/
+Process* ProcessManager_fork(Regs* regs);
+
 /*-------------------------------------------------------------------------
 | Wait process ID
 |--------------------------------------------------------------------------
@@ -104,6 +137,60 @@ Process* ProcessManager_spawnProcess(const char* binary);
 \------------------------------------------------------------------------*/
 void ProcessManager_waitPID(Process* process);
 
+/*-------------------------------------------------------------------------
+| Nice
+|--------------------------------------------------------------------------
+| DESCRIPTION:    Adds "increment" to the current process' nice value,
+|                 kept within 0 and PROCESS_NICE_MAX. Processes with a
+|                 higher value get less CPU time when others want it.
+|
+| PARAM:          'increment' amount to add, may be negative
+|
+| RETURN:         'int' the new nice value
+\------------------------------------------------------------------------*/
+int ProcessManager_nice(int increment);
+
+/*-------------------------------------------------------------------------
+| Reap killed process
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Does a bounded piece of the teardown of the oldest
+|                  killed process: one user page table, or the rest of
+|                  the process once its user memory is gone. Killed
+|                  processes are queued by ProcessManager_switch instead
+|                  of being freed inside the timer IRQ.
+|
+| RETURN:          bool  FALSE if there was nothing to do
+|
+| NOTES:           Called by the idle process, runs with interrupts enabled.
+\------------------------------------------------------------------------*/
+bool ProcessManager_reap(void);
+
+/*-------------------------------------------------------------------------
+| Refill process pool
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Builds one address space(page directory, kernel stack,
+|                  user stack) and adds it to the pool new processes are
+|                  taken from.
+|
+| RETURN:          bool  FALSE if there was nothing to do(pool is full or
+|                  memory is low)
+|
+| NOTES:           Called by the idle process, runs with interrupts enabled.
+\------------------------------------------------------------------------*/
+bool ProcessManager_refillPool(void);
+
+/*-------------------------------------------------------------------------
+| Get process
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns a user process by its position in the list of
+|                  every user process, the order changes as processes exit.
+|
+| PARAM:           'index' position in the list
+|
+| RETURN:          'Process*' the process, NULL if "index" is past the end
+\------------------------------------------------------------------------*/
+Process* ProcessManager_getProcess(u32int index);
+
 /*-------------------------------------------------------------------------
 | Block current process
 |--------------------------------------------------------------------------
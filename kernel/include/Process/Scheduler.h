@@ -58,6 +58,27 @@ extern Process* (*Scheduler_getNextProcess) (void);
 \------------------------------------------------------------------------*/
 extern Process* (*Scheduler_getCurrentProcess) (void);
 
+/*-------------------------------------------------------------------------
+| Timer tick
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Called on every timer tick(see PIT8253.c), charges the
+|                  tick to the current process.
+|
+| RETURN:          true    if the current process should be switched out
+|                  false   otherwise
+\------------------------------------------------------------------------*/
+extern bool (*Scheduler_tick) (void);
+
+/*-------------------------------------------------------------------------
+| Boost process
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Raises the priority of a process woken by user input,
+|                  does nothing if the scheduler has no priorities.
+|
+| PARAM:           'process'  the process to boost
+\------------------------------------------------------------------------*/
+extern void (*Scheduler_boostProcess) (Process* process);
+
 /*=======================================================
     FUNCTION
 =========================================================*/
@@ -30,11 +30,20 @@
 
 #include <Common.h>
 
+/*=======================================================
+    DEFINE
+=========================================================*/
+
+/* CPU_getFeatures flags */
+#define CPU_FEATURE_PSE (1 << 3)  /* 4MB pages */
+#define CPU_FEATURE_PGE (1 << 13) /* Global pages */
+
 /*=======================================================
     STRUCT
 =========================================================*/
 typedef struct CR0 CR0;
 typedef struct CR3 CR3;
+typedef struct CR4 CR4;
 
 struct CR0 {
 
@@ -62,6 +71,21 @@ struct CR3 {
 
 } __attribute__((packed));
 
+struct CR4 {
+
+    u8int VME :  1; /* Virtual 8086 mode extensions */
+    u8int PVI :  1; /* Protected mode virtual interrupts */
+    u8int TSD :  1; /* Time stamp disable */
+    u8int DE  :  1; /* Debugging extensions */
+    u8int PSE :  1; /* Page size extension, 4MB pages */
+    u8int PAE :  1; /* Physical address extension */
+    u8int MCE :  1; /* Machine check exception */
+    u8int PGE :  1; /* Page global enable */
+    u8int PCE :  1; /* Performance monitoring counter enable */
+    u32int    : 23;
+
+} __attribute__((packed));
+
 /*=======================================================
     FUNCTION
 =========================================================*/
@@ -90,4 +114,34 @@ u32int CPU_getCR(u8int n);
 | PRECONDITION:    "n"   needs to be 1..4
 \------------------------------------------------------------------------*/
 void CPU_setCR(u8int n, u32int val);
+
+/*-------------------------------------------------------------------------
+| Get CPU features
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the standard feature flags(CPUID 1, EDX).
+|
+| RETURN:          u32int   feature flags, see CPU_FEATURE_*
+\------------------------------------------------------------------------*/
+static inline u32int CPU_getFeatures(void) {
+
+    u32int eax = 1, ebx, ecx, edx;
+    asm volatile("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+    return edx;
+
+}
+
+/*-------------------------------------------------------------------------
+| Read time-stamp counter
+|--------------------------------------------------------------------------
+| DESCRIPTION:     Returns the number of clock cycles since CPU reset.
+|
+| RETURN:          u64int   time-stamp counter
+\------------------------------------------------------------------------*/
+static inline u64int CPU_readTimestamp(void) {
+
+    u32int low, high;
+    asm volatile("rdtsc" : "=a" (low), "=d" (high));
+    return ((u64int) high << 32) | low;
+
+}
 #endif
\ No newline at end of file
@@ -0,0 +1,348 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| Benchmark.c
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Kernel micro benchmarks, run once at boot when the kernel
+|               is compiled with '-D BENCHMARK'. Results are printed to the
+|               console in CPU cycles(time-stamp counter).
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#include <Benchmark.h>
+#include <Debug.h>
+#include <Memory.h>
+#include <X86/CPU.h>
+#include <Lib/Bitmap.h>
+#include <Lib/String.h>
+#include <Lib/LinkedList.h>
+#include <Memory/HeapMemory.h>
+#include <Memory/Slab.h>
+#include <Memory/TLSF.h>
+#include <Memory/DougLea.h>
+#include <Memory/PhysicalMemory.h>
+#include <Memory/VirtualMemory.h>
+#include <Process/ProcessManager.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define BITMAP_ALLOCATIONS 64
+
+#define SWITCH_ITERATIONS    1000
+#define SWITCH_TOUCHED_PAGES 64
+#define SWITCH_TOUCH_BASE    0x100000 /* Kernel image, identity mapped */
+
+#define TLB_ROUNDS      16
+#define TLB_PAGES       512
+#define TLB_ALIAS_VADDR 0xC00000 /* Free part of the temporary mapping area, 512 pages */
+
+#define SLAB_OBJECTS 128
+
+#define HEAP_TRACE_SLOTS 64
+#define HEAP_TRACE_STEPS 4096
+
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE Module benchModule;
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/* NOTE: "cycles" is the total of all iterations, kept 32-bit to avoid 64-bit division(no libgcc) */
+PRIVATE void Benchmark_print(const char* name, const char* variant, u32int cycles, u32int iterations) {
+
+    Console_printf("%s%s%s%s%s%d%s", "[BENCH] ", name, ", ", variant, ": ", cycles / iterations, " cycles\n");
+
+}
+
+/* Frame search as BitmapPMM used to do it, bit by bit from frame 0 */
+PRIVATE u32int Benchmark_bitScan(Bitmap* bitmap, u32int numberOfBits) {
+
+    for(u32int i = 0; i < numberOfBits; i++)
+        if(!Bitmap_isSet(bitmap, i))
+            return i;
+
+    return BITMAP_NOT_FOUND;
+
+}
+
+/* Allocation cost with 90% of memory in use, for a given amount of physical memory */
+PRIVATE void Benchmark_bitmapPMM(u32int memoryMB) {
+
+    u32int frames = memoryMB * (1024 * 1024 / FRAME_SIZE);
+    u32int length = (frames / 32) * sizeof(u32int);
+
+    u32int* words = HeapMemory_calloc(1, length);
+    u32int* summary = HeapMemory_calloc(1, Bitmap_getSummaryLength(length));
+    Debug_assert(words != NULL && summary != NULL);
+
+    char name[32];
+    String_copy(name, "BitmapPMM ");
+    String_copy(name + String_length(name), String_numberToString(memoryMB, 10));
+    String_copy(name + String_length(name), "MB");
+
+    Bitmap bitmap;
+    Bitmap_init(&bitmap, words, length);
+
+    for(u32int variant = 0; variant < 3; variant++) {
+
+        if(variant == 2)
+            Bitmap_initSummary(&bitmap, summary);
+
+        Bitmap_setRange(&bitmap, 0, frames);
+        Bitmap_clearRange(&bitmap, frames - frames / 10, frames / 10);
+
+        u64int begin = CPU_readTimestamp();
+
+        for(u32int i = 0; i < BITMAP_ALLOCATIONS; i++) {
+
+            if(variant == 1) /* Word scan alone, search from word 0 every time */
+                bitmap.hint = 0;
+
+            u32int index = variant == 0 ? Benchmark_bitScan(&bitmap, frames) : Bitmap_findFirstClear(&bitmap);
+            Debug_assert(index != BITMAP_NOT_FOUND);
+            Bitmap_setBit(&bitmap, index);
+
+        }
+
+        u32int cycles = (u32int) (CPU_readTimestamp() - begin);
+
+        if(variant == 0)
+            Benchmark_print(name, "bit scan", cycles, BITMAP_ALLOCATIONS);
+        else if(variant == 1)
+            Benchmark_print(name, "word scan", cycles, BITMAP_ALLOCATIONS);
+        else
+            Benchmark_print(name, "summary + hint", cycles, BITMAP_ALLOCATIONS);
+
+    }
+
+    HeapMemory_free(summary);
+    HeapMemory_free(words);
+
+}
+
+/* Reads a word from each page, like a syscall or interrupt touching kernel code and data */
+PRIVATE void Benchmark_touchKernel(void) {
+
+    for(u32int i = 0; i < SWITCH_TOUCHED_PAGES; i++)
+        (void) *((volatile u32int*) (SWITCH_TOUCH_BASE + i * FRAME_SIZE));
+
+}
+
+/* Address space switch followed by kernel work, with and without global kernel pages */
+PRIVATE void Benchmark_addressSpaceSwitch(void) {
+
+    Process* process = HeapMemory_calloc(1, sizeof(Process));
+    Debug_assert(process != NULL);
+
+    VirtualMemory_createPageDirectory(process);
+
+    PageDirectory* dirs[2] = {VirtualMemory_getKernelDir(), process->pageDir};
+    u32int cr4 = CPU_getCR(4);
+    u32int variants = (CPU_getFeatures() & CPU_FEATURE_PGE) ? 3 : 2;
+
+    for(u32int variant = 0; variant < variants; variant++) {
+
+        /* Changing PGE flushes the whole TLB */
+        CR4 reg = FORCE_CAST(cr4, CR4);
+        reg.PGE = variant == 2;
+        CPU_setCR(4, FORCE_CAST(reg, u32int));
+
+        u64int begin = CPU_readTimestamp();
+
+        for(u32int i = 0; i < SWITCH_ITERATIONS; i++) {
+
+            VirtualMemory_switchPageDir(dirs[i % 2]);
+
+            if(variant == 0) /* Second CR3 load, as the switch used to do */
+                VirtualMemory_switchPageDir(dirs[i % 2]);
+
+            Benchmark_touchKernel();
+
+        }
+
+        u32int cycles = (u32int) (CPU_readTimestamp() - begin);
+
+        if(variant == 0)
+            Benchmark_print("Address space switch", "double flush", cycles, SWITCH_ITERATIONS);
+        else if(variant == 1)
+            Benchmark_print("Address space switch", "single flush", cycles, SWITCH_ITERATIONS);
+        else
+            Benchmark_print("Address space switch", "global pages", cycles, SWITCH_ITERATIONS);
+
+    }
+
+    CPU_setCR(4, cr4);
+    VirtualMemory_switchPageDir(dirs[0]);
+    VirtualMemory_destroyPageDirectory(process);
+    HeapMemory_free(process);
+
+}
+
+/* Reads a word from each of TLB_PAGES pages, TLB_ROUNDS times. Returns cycles per read */
+PRIVATE u32int Benchmark_touchPages(u32int base) {
+
+    u64int begin = CPU_readTimestamp();
+
+    for(u32int round = 0; round < TLB_ROUNDS; round++)
+        for(u32int i = 0; i < TLB_PAGES; i++)
+            (void) *((volatile u32int*) (base + i * FRAME_SIZE));
+
+    return (u32int) (CPU_readTimestamp() - begin) / (TLB_ROUNDS * TLB_PAGES);
+
+}
+
+/* Same physical memory read through 4KB pages and through the direct map(4MB pages if PSE is used) */
+PRIVATE void Benchmark_largePages(void) {
+
+    for(u32int i = 0; i < TLB_PAGES; i++)
+        VirtualMemory_quickMap((void*) (TLB_ALIAS_VADDR + i * FRAME_SIZE), (void*) (SWITCH_TOUCH_BASE + i * FRAME_SIZE));
+
+    Benchmark_touchPages(TLB_ALIAS_VADDR); /* Warm up caches */
+    Benchmark_print("TLB reach", "4KB pages", Benchmark_touchPages(TLB_ALIAS_VADDR), 1);
+
+    if(VirtualMemory_isLargePage((void*) (DIRECT_MAP_VADDR + SWITCH_TOUCH_BASE)))
+        Benchmark_print("TLB reach", "4MB page", Benchmark_touchPages(DIRECT_MAP_VADDR + SWITCH_TOUCH_BASE), 1);
+    else
+        Benchmark_print("TLB reach", "4KB pages(direct map)", Benchmark_touchPages(DIRECT_MAP_VADDR + SWITCH_TOUCH_BASE), 1);
+
+    for(u32int i = 0; i < TLB_PAGES; i++)
+        VirtualMemory_quickUnmap((void*) (TLB_ALIAS_VADDR + i * FRAME_SIZE));
+
+}
+
+/* Allocating and freeing a batch of list nodes from the heap and from a slab cache, measured after a warm up round */
+PRIVATE void Benchmark_slab(void) {
+
+    void* objects[SLAB_OBJECTS];
+    SlabCache* cache = Slab_createCache("Benchmark", sizeof(Node), 16);
+
+    for(u32int variant = 0; variant < 2; variant++) {
+
+        u32int cycles = 0;
+
+        for(u32int round = 0; round < 2; round++) {
+
+            u64int begin = CPU_readTimestamp();
+
+            for(u32int i = 0; i < SLAB_OBJECTS; i++)
+                objects[i] = variant == 0 ? HeapMemory_calloc(1, sizeof(Node)) : Slab_alloc(cache);
+
+            for(u32int i = 0; i < SLAB_OBJECTS; i++)
+                if(variant == 0)
+                    HeapMemory_free(objects[i]);
+                else
+                    Slab_free(cache, objects[i]);
+
+            cycles = (u32int) (CPU_readTimestamp() - begin);
+
+        }
+
+        Benchmark_print("Small object alloc + free", variant == 0 ? "heap" : "slab", cycles, SLAB_OBJECTS);
+
+    }
+
+}
+
+/* Mixed size trace, a random slot is freed if in use, otherwise filled with a mostly small, sometimes
+   page sized, rarely large block. Returns total cycles, "worst" gets the slowest single call */
+PRIVATE u32int Benchmark_heapTrace(void* (*allocate) (size_t), void (*release) (void*), u32int* worst) {
+
+    void* slots[HEAP_TRACE_SLOTS];
+    Memory_set(slots, 0, sizeof(slots));
+
+    u32int seed = 1; /* Same trace for every heap manager */
+    u32int total = 0;
+    *worst = 0;
+
+    for(u32int i = 0; i < HEAP_TRACE_STEPS; i++) {
+
+        seed = seed * 1103515245 + 12345;
+        u32int slot = (seed >> 8) % HEAP_TRACE_SLOTS;
+        u32int kind = (seed >> 14) % 100;
+        u32int size = kind < 70 ? 16 + (seed >> 20) % 240 : (kind < 95 ? 256 + (seed >> 20) % 4096 : 16384 + (seed >> 20) % 16384);
+
+        u64int begin = CPU_readTimestamp();
+
+        if(slots[slot] != NULL) {
+
+            release(slots[slot]);
+            slots[slot] = NULL;
+
+        } else {
+
+            slots[slot] = allocate(size);
+
+        }
+
+        u32int cycles = (u32int) (CPU_readTimestamp() - begin);
+        total += cycles;
+
+        if(cycles > *worst)
+            *worst = cycles;
+
+    }
+
+    for(u32int i = 0; i < HEAP_TRACE_SLOTS; i++)
+        if(slots[i] != NULL)
+            release(slots[i]);
+
+    return total;
+
+}
+
+/* DougLea against TLSF on the same trace, the first run grows both heaps and is not measured */
+PRIVATE void Benchmark_heapManagers(void) {
+
+    u32int worst;
+
+    Benchmark_heapTrace(&DougLea_malloc, &DougLea_free, &worst);
+    Benchmark_print("Heap mixed trace", "DougLea average", Benchmark_heapTrace(&DougLea_malloc, &DougLea_free, &worst), HEAP_TRACE_STEPS);
+    Benchmark_print("Heap mixed trace", "DougLea worst", worst, 1);
+
+    Benchmark_heapTrace(&TLSF_malloc, &TLSF_free, &worst);
+    Benchmark_print("Heap mixed trace", "TLSF average", Benchmark_heapTrace(&TLSF_malloc, &TLSF_free, &worst), HEAP_TRACE_STEPS);
+    Benchmark_print("Heap mixed trace", "TLSF worst", worst, 1);
+
+}
+
+PRIVATE void Benchmark_init(void) {
+
+    Debug_logInfo("%s%s", "Initialising ", benchModule.moduleName);
+
+    u32int sizes[] = {4, 64, 512, 3584};
+
+    for(u32int i = 0; i < ARRAY_SIZE(sizes); i++)
+        Benchmark_bitmapPMM(sizes[i]);
+
+    Benchmark_addressSpaceSwitch();
+    Benchmark_largePages();
+    Benchmark_slab();
+    Benchmark_heapManagers();
+
+}
+
+PUBLIC Module* Benchmark_getModule(void) {
+
+    if(!benchModule.isLoaded) {
+
+        benchModule.moduleName = "Benchmarks";
+        benchModule.moduleID = MODULE_BENCHMARK;
+        benchModule.init = &Benchmark_init;
+        benchModule.numberOfDependencies = 1;
+        benchModule.dependencies[0] = MODULE_HEAP;
+
+    }
+
+    return &benchModule;
+
+}
@@ -216,8 +216,12 @@ PRIVATE void Keyboard_callback(void) {
 
                     CircularFIFOBuffer_write(keyBuffer, b);
 
-                    if(focused != NULL)
+                    if(focused != NULL) { /* Wake the reader, it is interactive so it goes first */
+
                         focused->status = PROCESS_WAITING;
+                        Scheduler_boostProcess(focused);
+
+                    }
 
                 }
 
@@ -9,6 +9,11 @@
 |
 | DESCRIPTION:  Tar-based ramdisk(RAM as disk drive) implementation.
 |
+|               mk.sh pads the archive with RAMDISK_PADDING_NAME entries so
+|               that executables start on a page boundary, these pages can
+|               then be mapped into processes without copying.
+|               Padding entries are not visible as files.
+|
 | AUTHOR:       Ali Ersenal, aliersenal@gmail.com
 \------------------------------------------------------------------------*/
 
@@ -18,6 +23,7 @@
 #include <Memory.h>
 #include <Lib/String.h>
 #include <Memory/HeapMemory.h>
+#include <Memory/PhysicalMemory.h>
 #include <Multiboot.h>
 
 /*=======================================================
@@ -25,6 +31,7 @@
 =========================================================*/
 #define ROOT_INDEX  -1
 #define RAMDISK_DEVICE_ID 0xBEEF
+#define RAMDISK_PADDING_NAME ".pad"
 
 /*=======================================================
     PRIVATE DATA
@@ -43,6 +50,7 @@ PRIVATE void RamDisk_parseArchive(const TarEntryHeader* firstHeader) {
 
     Debug_assert(firstHeader != NULL);
     u32int i = 0;
+    u32int headerIndex = 0;
 
     /* For every file in archive */
     while(TRUE) {
@@ -50,13 +58,25 @@ PRIVATE void RamDisk_parseArchive(const TarEntryHeader* firstHeader) {
         if (firstHeader->fileName[0] == '\0')
             break;
 
+        if(String_compare(firstHeader->fileName, RAMDISK_PADDING_NAME) == 0) { /* Alignment padding, not a file */
+
+            firstHeader = Tar_nextHeader(firstHeader);
+            headerIndex++;
+
+            if(firstHeader == NULL)
+                break;
+
+            continue;
+
+        }
+
         /* Add tar file as a virtual file */
         String_copy(fileNodes[i].fileName, firstHeader->fileName);
         fileNodes[i].permission = 0;
         fileNodes[i].uid = 0;
         fileNodes[i].gid = 0;
         fileNodes[i].fileSize = String_stringToInt(firstHeader->fileSize, 8) ;
-        fileNodes[i].index = i;
+        fileNodes[i].index = headerIndex; /* Index of tar header, see RamDisk_read */
         fileNodes[i].vfs = &ramdisk;
         fileNodes[i].ptr = 0;
         fileNodes[i].mode = FILE_MODE_NOT_OPEN;
@@ -93,6 +113,7 @@ PRIVATE void RamDisk_parseArchive(const TarEntryHeader* firstHeader) {
         }
 
         firstHeader = Tar_nextHeader(firstHeader);
+        headerIndex++;
         i++;
 
         if(firstHeader == NULL)
@@ -100,6 +121,8 @@ PRIVATE void RamDisk_parseArchive(const TarEntryHeader* firstHeader) {
 
     }
 
+    numberOfFiles = i;
+
 }
 
 PRIVATE u32int RamDisk_read(VFSNode* self, u32int offset, u32int count, char* buffer) {
@@ -116,6 +139,21 @@ PRIVATE u32int RamDisk_read(VFSNode* self, u32int offset, u32int count, char* bu
 
 }
 
+/* Return the frame holding file data at "offset", if it is page aligned in memory */
+PRIVATE void* RamDisk_getFrame(VFSNode* self, u32int offset) {
+
+    TarEntryHeader* header = Tar_getHeader((TarEntryHeader*) firstHeaderAddress, self->index);
+    Debug_assert(header != NULL);
+
+    u32int data = (u32int) header + TAR_BLOCK_SIZE + offset;
+
+    if(data % FRAME_SIZE != 0) /* Archive was not padded for this file */
+        return NULL;
+
+    return (void*) data; /* Initrd is identity mapped */
+
+}
+
 /* Return nth child of a directory */
 PRIVATE VFSNode* RamDisk_readDir(VFSNode* self, u32int index) {
 
@@ -173,7 +211,7 @@ PUBLIC VFS* RamDisk_init(void) {
     extern MultibootInfo* multibootInfo; /* Defined in Kernel.c */
     firstHeaderAddress = *((u32int*) multibootInfo->modsAddr);
 
-    /* Reserve space in heap for virtual file nodes */
+    /* Reserve space in heap for virtual file nodes(padding entries included, numberOfFiles is updated while parsing) */
     numberOfFiles = Tar_getNumberOfFiles((TarEntryHeader*) firstHeaderAddress);
     fileNodes = HeapMemory_calloc(numberOfFiles, sizeof(VFSNode));
 
@@ -194,6 +232,7 @@ PUBLIC VFS* RamDisk_init(void) {
     ramdisk.readDir = RamDisk_readDir;
     ramdisk.findDir = RamDisk_findDir;
     ramdisk.read = RamDisk_read;
+    ramdisk.getFrame = RamDisk_getFrame;
     ramdisk.write = NULL; /* our ramdisk does not support 'write' */
     ramdisk.open = NULL; /* our ramdisk does not need 'open' */
     ramdisk.close = NULL; /* our ramdisk does not need 'close' */
@@ -20,6 +20,8 @@
 #include <Process/Scheduler.h>
 #include <Process/ProcessManager.h>
 #include <Memory.h>
+#include <Memory/PhysicalMemory.h>
+#include <Memory/Arena.h>
 
 /*=======================================================
     PRIVATE DATA
@@ -121,22 +123,22 @@ PUBLIC VFSNode* VFS_getParent(VFSNode* child) {
 
     Debug_assert(child != NULL);
 
-    int childNameLength = String_length(child->fileName);
-    char childName[childNameLength];
-    String_copy(childName, child->fileName);
+    if(String_countChar(child->fileName, '/') == 0)
+        return rootFS->rootNode;
 
-    if(String_countChar(childName, '/') == 0)
+    if(child->fileType == FILETYPE_DIRECTORY && String_countChar(child->fileName, '/') == 1)
         return rootFS->rootNode;
 
-    if(child->fileType == FILETYPE_DIRECTORY) {
+    Arena* scratch = Arena_getScratch();
+    ArenaMark mark = Arena_begin(scratch);
 
-        if(String_countChar(childName, '/') == 1)
-            return rootFS->rootNode;
+    int childNameLength = String_length(child->fileName);
+    char* childName = Arena_alloc(scratch, childNameLength + 1);
+    String_copy(childName, child->fileName);
 
+    if(child->fileType == FILETYPE_DIRECTORY)
         childName[childNameLength - 1] = '\0';
 
-    }
-
     for(int i = childNameLength - 1; i >= 0; i--) {
 
          if(childName[i] == '/') {
@@ -146,7 +148,10 @@ PUBLIC VFSNode* VFS_getParent(VFSNode* child) {
 
     }
 
-    return VFS_searchForFile(rootFS->rootNode, childName);
+    VFSNode* parent = VFS_searchForFile(rootFS->rootNode, childName);
+    Arena_reset(scratch, mark);
+
+    return parent;
 
 }
 
@@ -238,6 +243,40 @@ PUBLIC u32int VFS_read(VFSNode* self, u32int offset, u32int count, char* buffer)
 
 }
 
+PUBLIC u32int VFS_readImage(VFSNode* self, u32int offset, u32int count, char* buffer) {
+
+    Debug_assert(self != NULL);
+    Debug_assert(buffer != NULL);
+    Debug_assert(self->vfs != NULL); /* Ensure we have a valid node */
+    Debug_assert(offset + count <= self->fileSize); /* Valid boundaries? */
+    Debug_assert(self->fileType == FILETYPE_NORMAL);
+
+    if(count == 0)
+        return 0;
+
+    /* File system read null terminates(buffer[count]), don't let it write past "count" bytes */
+    char last[2];
+    self->vfs->read(self, offset, count - 1, buffer);
+    self->vfs->read(self, offset + count - 1, 1, last);
+    buffer[count - 1] = last[0];
+
+    return count;
+
+}
+
+PUBLIC void* VFS_getImageFrame(VFSNode* self, u32int offset) {
+
+    Debug_assert(self != NULL);
+    Debug_assert(self->vfs != NULL); /* Ensure we have a valid node */
+    Debug_assert(offset % FRAME_SIZE == 0 && offset < self->fileSize);
+
+    if(self->vfs->getFrame == NULL) /* File system can't map files */
+        return NULL;
+
+    return self->vfs->getFrame(self, offset);
+
+}
+
 PUBLIC u32int VFS_write(VFSNode* self, u32int offset, u32int count, const char* buffer) {
 
     Debug_assert(self != NULL);
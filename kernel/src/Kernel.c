@@ -31,13 +31,19 @@
 #include <FileSystem/VFS.h>
 #include <X86/Usermode.h>
 #include <Memory.h>
+#include <Benchmark.h>
 
 PUBLIC MultibootInfo* multibootInfo;
 
 PUBLIC void Kernel_idle(void) {
 
-    while(1)
-        Sys_haltCPU();
+    while(1) {
+
+        /* Use idle time to free killed processes, zero frames and build address spaces in advance, halt when there is nothing to do */
+        if(!ProcessManager_reap() && !PhysicalMemory_refillZeroedPool() && !ProcessManager_refillPool())
+            Sys_haltCPU();
+
+    }
 
 }
 
@@ -64,6 +70,9 @@ PUBLIC void Kernel(MultibootInfo* mbInfo, u32int mbMagic) {
         PS2Controller_getModule(),
         VFS_getModule(),
         ProcessManager_getModule(),
+#ifdef BENCHMARK
+        Benchmark_getModule(),
+#endif
         Usermode_getModule(),
 
     };
@@ -15,6 +15,7 @@
 
 #include <Lib/ArrayList.h>
 #include <Memory/HeapMemory.h>
+#include <Memory/Slab.h>
 #include <Debug.h>
 
 /*=======================================================
@@ -29,6 +30,11 @@ struct ArrayList {
 
 };
 
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE SlabCache* arrayListCache;
+
 /*=======================================================
     FUNCTION
 =========================================================*/
@@ -113,14 +119,17 @@ PUBLIC bool ArrayList_isEmpty(ArrayList* self) {
 PUBLIC void ArrayList_destroy(ArrayList* self) {
 
     HeapMemory_free(self->arrayPointer);
-    HeapMemory_free(self);
+    Slab_free(arrayListCache, self);
 
 }
 
 PUBLIC ArrayList* ArrayList_new(u32int initialLength) {
 
     /* allocate memory */
-    ArrayList* self = (ArrayList*) HeapMemory_alloc(sizeof(ArrayList));
+    if(arrayListCache == NULL)
+        arrayListCache = Slab_createCache("ArrayList", sizeof(ArrayList), 0);
+
+    ArrayList* self = (ArrayList*) Slab_alloc(arrayListCache);
     Debug_assert(self);
 
     Debug_assert(initialLength > 0);
@@ -9,6 +9,11 @@
 |
 | DESCRIPTION:  Bit array data structure implementation.
 |
+|               Bits are stored in 32-bit words, bit n lives in word n / 32.
+|               If a summary is attached, summary bit w is set whenever
+|               word w is full, so a search for a clear bit skips 1024 used
+|               bits per summary word.
+|
 | AUTHOR:       Ali Ersenal, aliersenal@gmail.com
 \------------------------------------------------------------------------*/
 
@@ -21,15 +26,106 @@
 =========================================================*/
 #define CHECK_INDEX Debug_assert((index / 8) < self->length);
 
+#define WORD_BITS       32
+#define FULL_WORD       0xFFFFFFFF
+#define WORD(index)     (((u32int*) self->start) + ((index) / WORD_BITS))
+
+/* Range operations */
+#define OP_SET   0
+#define OP_CLEAR 1
+#define OP_COUNT 2
+
 /*=======================================================
     FUNCTION
 =========================================================*/
+
+PRIVATE inline u32int Bitmap_numberOfWords(Bitmap* self) {
+
+    return self->length / sizeof(u32int);
+
+}
+
+PRIVATE u32int Bitmap_countBits(u32int word) {
+
+    word = word - ((word >> 1) & 0x55555555);
+    word = (word & 0x33333333) + ((word >> 2) & 0x33333333);
+    word = (word + (word >> 4)) & 0x0F0F0F0F;
+
+    return (word * 0x01010101) >> 24;
+
+}
+
+/* Keep summary and hint in sync after word "wordIndex" changed */
+PRIVATE inline void Bitmap_updateWord(Bitmap* self, u32int wordIndex) {
+
+    u32int word = ((u32int*) self->start)[wordIndex];
+
+    if(word != FULL_WORD && wordIndex < self->hint)
+        self->hint = wordIndex;
+
+    if(self->summary == NULL)
+        return;
+
+    if(word == FULL_WORD)
+        self->summary[wordIndex / WORD_BITS] |= 1 << (wordIndex % WORD_BITS);
+    else
+        self->summary[wordIndex / WORD_BITS] &= ~(1 << (wordIndex % WORD_BITS));
+
+}
+
+/* Applies "op" to [index, index + count) a word at a time, returns the number of affected bits */
+PRIVATE u32int Bitmap_rangeOp(Bitmap* self, u32int index, u32int count, u8int op) {
+
+    Debug_assert(count == 0 || ((index + count - 1) / 8) < self->length);
+
+    u32int affected = 0;
+
+    while(count > 0) {
+
+        u32int bit = index % WORD_BITS;
+        u32int n = WORD_BITS - bit;
+
+        if(n > count)
+            n = count;
+
+        u32int mask = (n == WORD_BITS) ? FULL_WORD : ((1U << n) - 1) << bit;
+        u32int* word = WORD(index);
+
+        switch(op) {
+
+            case OP_SET:
+            affected += n - Bitmap_countBits(*word & mask);
+            *word |= mask;
+            Bitmap_updateWord(self, index / WORD_BITS);
+            break;
+
+            case OP_CLEAR:
+            affected += Bitmap_countBits(*word & mask);
+            *word &= ~mask;
+            Bitmap_updateWord(self, index / WORD_BITS);
+            break;
+
+            case OP_COUNT:
+            affected += Bitmap_countBits(*word & mask);
+            break;
+
+        }
+
+        index += n;
+        count -= n;
+
+    }
+
+    return affected;
+
+}
+
 PUBLIC void Bitmap_setBit(Bitmap* self, u32int index) {
 
     CHECK_INDEX
 
-    char* byte = self->start + (index / 8);
-    *byte |= (1 << (index % 8));
+    *WORD(index) |= 1 << (index % WORD_BITS);
+    Bitmap_updateWord(self, index / WORD_BITS);
 
 }
 
@@ -37,8 +133,8 @@ PUBLIC void Bitmap_clearBit(Bitmap* self, u32int index) {
 
     CHECK_INDEX
 
-    char* byte = self->start + (index / 8);
-    *byte &= ~(1 << (index % 8));
+    *WORD(index) &= ~(1 << (index % WORD_BITS));
+    Bitmap_updateWord(self, index / WORD_BITS);
 
 }
 
@@ -46,8 +142,7 @@ PUBLIC bool Bitmap_isSet(Bitmap* self, u32int index) {
 
     CHECK_INDEX
 
-    char* byte = self->start + (index / 8);
-    return *byte & (1 << (index % 8));
+    return (*WORD(index) >> (index % WORD_BITS)) & 1;
 
 }
 
@@ -62,9 +157,134 @@ PUBLIC void Bitmap_toggle(Bitmap* self, u32int index) {
 
 }
 
+PUBLIC u32int Bitmap_setRange(Bitmap* self, u32int index, u32int count) {
+
+    return Bitmap_rangeOp(self, index, count, OP_SET);
+
+}
+
+PUBLIC u32int Bitmap_clearRange(Bitmap* self, u32int index, u32int count) {
+
+    return Bitmap_rangeOp(self, index, count, OP_CLEAR);
+
+}
+
+PUBLIC u32int Bitmap_countSet(Bitmap* self, u32int index, u32int count) {
+
+    return Bitmap_rangeOp(self, index, count, OP_COUNT);
+
+}
+
+PUBLIC u32int Bitmap_findFirstClear(Bitmap* self) {
+
+    u32int* words = self->start;
+    u32int numberOfWords = Bitmap_numberOfWords(self);
+    u32int wordIndex = self->hint;
+
+    if(wordIndex >= numberOfWords) /* Every word is full */
+        return BITMAP_NOT_FOUND;
+
+    if(self->summary != NULL) { /* Skip full words 32 at a time */
+
+        u32int summaryIndex = wordIndex / WORD_BITS;
+        u32int summaryWords = (numberOfWords + WORD_BITS - 1) / WORD_BITS;
+
+        /* Ignore summary bits below the hint */
+        u32int summary = self->summary[summaryIndex] | ((1U << (wordIndex % WORD_BITS)) - 1);
+
+        while(summary == FULL_WORD) {
+
+            summaryIndex++;
+
+            if(summaryIndex >= summaryWords) {
+                self->hint = numberOfWords;
+                return BITMAP_NOT_FOUND;
+            }
+
+            summary = self->summary[summaryIndex];
+
+        }
+
+        wordIndex = summaryIndex * WORD_BITS + __builtin_ctz(~summary);
+
+    } else { /* Skip full words one at a time */
+
+        while(wordIndex < numberOfWords && words[wordIndex] == FULL_WORD)
+            wordIndex++;
+
+    }
+
+    self->hint = wordIndex;
+
+    if(wordIndex >= numberOfWords)
+        return BITMAP_NOT_FOUND;
+
+    return wordIndex * WORD_BITS + __builtin_ctz(~words[wordIndex]);
+
+}
+
+/* Sets the lowest "count" clear bits, storing their indices. Returns the number of bits set */
+PUBLIC u32int Bitmap_setFirstClear(Bitmap* self, u32int count, u32int* indices) {
+
+    u32int* words = self->start;
+    u32int found = 0;
+
+    while(found < count) {
+
+        u32int index = Bitmap_findFirstClear(self);
+
+        if(index == BITMAP_NOT_FOUND)
+            break;
+
+        /* Take every clear bit of this word before looking further */
+        u32int wordIndex = index / WORD_BITS;
+
+        while(words[wordIndex] != FULL_WORD && found < count) {
+
+            u32int bit = __builtin_ctz(~words[wordIndex]);
+            words[wordIndex] |= 1U << bit;
+            indices[found++] = wordIndex * WORD_BITS + bit;
+
+        }
+
+        Bitmap_updateWord(self, wordIndex);
+
+    }
+
+    return found;
+
+}
+
+PUBLIC u32int Bitmap_getSummaryLength(u32int length) {
+
+    u32int numberOfWords = length / sizeof(u32int);
+    return ((numberOfWords + WORD_BITS - 1) / WORD_BITS) * sizeof(u32int);
+
+}
+
+PUBLIC void Bitmap_initSummary(Bitmap* self, void* summary) {
+
+    Debug_assert(summary != NULL && (u32int) summary % sizeof(u32int) == 0);
+
+    u32int numberOfWords = Bitmap_numberOfWords(self);
+    self->summary = summary;
+
+    /* Summary bits past the last word are marked full so they are never picked */
+    for(u32int i = 0; i < Bitmap_getSummaryLength(self->length) / sizeof(u32int); i++)
+        self->summary[i] = FULL_WORD;
+
+    for(u32int i = 0; i < numberOfWords; i++)
+        Bitmap_updateWord(self, i);
+
+}
+
 PUBLIC void Bitmap_init(Bitmap* self, void* start, u32int length) {
 
+    Debug_assert((u32int) start % sizeof(u32int) == 0 && length % sizeof(u32int) == 0);
+
     self->start = start;
     self->length = length;
+    self->summary = NULL;
+    self->hint = 0;
 
-}
\ No newline at end of file
+}
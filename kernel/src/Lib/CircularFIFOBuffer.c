@@ -15,6 +15,7 @@
 
 #include <Lib/CircularFIFOBuffer.h>
 #include <Memory/HeapMemory.h>
+#include <Memory/Slab.h>
 #include <Debug.h>
 
 /*=======================================================
@@ -32,13 +33,21 @@ struct CircularFIFOBuffer {
 
 };
 
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE SlabCache* bufferCache;
+
 /*=======================================================
     FUNCTION
 =========================================================*/
 
 PUBLIC CircularFIFOBuffer* CircularFIFOBuffer_new(u32int size) {
 
-    CircularFIFOBuffer* buffer = HeapMemory_calloc(1, sizeof(CircularFIFOBuffer));
+    if(bufferCache == NULL)
+        bufferCache = Slab_createCache("CircularFIFOBuffer", sizeof(CircularFIFOBuffer), 0);
+
+    CircularFIFOBuffer* buffer = Slab_alloc(bufferCache);
     Debug_assert(buffer);
 
     buffer->start = HeapMemory_calloc(1, size);
@@ -57,7 +66,7 @@ PUBLIC CircularFIFOBuffer* CircularFIFOBuffer_new(u32int size) {
 PUBLIC void CircularFIFOBuffer_destroy(CircularFIFOBuffer* buf) {
 
     HeapMemory_free(buf->start);
-    HeapMemory_free(buf);
+    Slab_free(bufferCache, buf);
 
 }
 
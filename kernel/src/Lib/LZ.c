@@ -0,0 +1,208 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| LZ.c
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  LZ77 family compressor, favours speed over ratio.
+|
+|               A block is a series of sequences, each one is a token byte
+|               (high nibble literal count, low nibble match length - 4),
+|               the literals, a 2 byte little endian match offset and the
+|               match. Counts of 15 continue in following bytes, 255 means
+|               another byte follows. The last sequence has no match.
+|
+|               Matches are found through a hash table of 4 byte prefixes,
+|               only the latest position of every prefix is remembered.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#include <Lib/LZ.h>
+#include <Memory.h>
+#include <Debug.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define LZ_MIN_MATCH  4
+#define LZ_NIBBLE_MAX 15
+#define LZ_EMPTY      0xFFFF
+
+#define LZ_READ32(p)  ((u32int) (p)[0] | (u32int) (p)[1] << 8 | (u32int) (p)[2] << 16 | (u32int) (p)[3] << 24)
+#define LZ_HASH(v)    (((v) * 2654435761U) >> (32 - LZ_HASH_BITS))
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/* Writes the part of a count that did not fit in its nibble */
+PRIVATE u32int LZ_writeCount(u8int* destination, u32int count) {
+
+    u32int written = 0;
+
+    while(count >= 255) {
+
+        destination[written++] = 255;
+        count -= 255;
+
+    }
+
+    destination[written++] = count;
+
+    return written;
+
+}
+
+/* Emits one sequence, returns the new output position or 0 if it does not fit */
+PRIVATE u32int LZ_writeSequence(const u8int* literals, u32int literalCount, u32int offset, u32int matchLength,
+                                u8int* destination, u32int position, u32int capacity) {
+
+    /* Worst case: token, both counts, literals and offset */
+    u32int worstCase = 1 + (literalCount / 255 + 1) + literalCount + 2 + (matchLength / 255 + 1);
+
+    if(position + worstCase > capacity)
+        return 0;
+
+    u32int matchCount = matchLength == 0 ? 0 : matchLength - LZ_MIN_MATCH;
+    u8int* token = &destination[position++];
+
+    *token = (literalCount < LZ_NIBBLE_MAX ? literalCount : LZ_NIBBLE_MAX) << 4;
+
+    if(literalCount >= LZ_NIBBLE_MAX)
+        position += LZ_writeCount(&destination[position], literalCount - LZ_NIBBLE_MAX);
+
+    Memory_copy(&destination[position], literals, literalCount);
+    position += literalCount;
+
+    if(matchLength == 0) /* Last sequence */
+        return position;
+
+    destination[position++] = offset & 0xFF;
+    destination[position++] = offset >> 8;
+    *token |= matchCount < LZ_NIBBLE_MAX ? matchCount : LZ_NIBBLE_MAX;
+
+    if(matchCount >= LZ_NIBBLE_MAX)
+        position += LZ_writeCount(&destination[position], matchCount - LZ_NIBBLE_MAX);
+
+    return position;
+
+}
+
+/* Reads the rest of a count whose nibble was 15, returns FALSE if the block ends first */
+PRIVATE bool LZ_readCount(const u8int* source, u32int length, u32int* position, u32int* count) {
+
+    u8int byte;
+
+    do {
+
+        if(*position >= length)
+            return FALSE;
+
+        byte = source[(*position)++];
+        *count += byte;
+
+    } while(byte == 255);
+
+    return TRUE;
+
+}
+
+PUBLIC u32int LZ_compress(const u8int* source, u32int length, u8int* destination, u32int capacity, void* workspace) {
+
+    Debug_assert(source != NULL && destination != NULL && workspace != NULL);
+    Debug_assert(length <= LZ_MAX_LENGTH);
+
+    u16int* table = workspace;
+    u32int input = 0;
+    u32int anchor = 0; /* Start of pending literals */
+    u32int output = 0;
+
+    Memory_set(table, 0xFF, LZ_WORKSPACE_SIZE); /* Every slot LZ_EMPTY */
+
+    while(input + LZ_MIN_MATCH <= length) {
+
+        u32int prefix = LZ_READ32(&source[input]);
+        u32int hash = LZ_HASH(prefix);
+        u32int candidate = table[hash];
+        table[hash] = input;
+
+        if(candidate == LZ_EMPTY || LZ_READ32(&source[candidate]) != prefix) {
+
+            input++;
+            continue;
+
+        }
+
+        u32int matchLength = LZ_MIN_MATCH;
+
+        while(input + matchLength < length && source[candidate + matchLength] == source[input + matchLength])
+            matchLength++;
+
+        output = LZ_writeSequence(&source[anchor], input - anchor, input - candidate, matchLength, destination, output, capacity);
+
+        if(output == 0)
+            return 0;
+
+        input += matchLength;
+        anchor = input;
+
+    }
+
+    return LZ_writeSequence(&source[anchor], length - anchor, 0, 0, destination, output, capacity);
+
+}
+
+PUBLIC u32int LZ_decompress(const u8int* source, u32int length, u8int* destination, u32int capacity) {
+
+    Debug_assert(source != NULL && destination != NULL);
+
+    u32int input = 0;
+    u32int output = 0;
+
+    while(input < length) {
+
+        u8int token = source[input++];
+        u32int literalCount = token >> 4;
+
+        if(literalCount == LZ_NIBBLE_MAX && !LZ_readCount(source, length, &input, &literalCount))
+            return 0;
+
+        if(input + literalCount > length || output + literalCount > capacity)
+            return 0;
+
+        Memory_copy(&destination[output], &source[input], literalCount);
+        input += literalCount;
+        output += literalCount;
+
+        if(input == length) /* Last sequence has no match */
+            break;
+
+        if(input + 2 > length)
+            return 0;
+
+        u32int offset = source[input] | source[input + 1] << 8;
+        u32int matchLength = token & LZ_NIBBLE_MAX;
+        input += 2;
+
+        if(matchLength == LZ_NIBBLE_MAX && !LZ_readCount(source, length, &input, &matchLength))
+            return 0;
+
+        matchLength += LZ_MIN_MATCH;
+
+        if(offset == 0 || offset > output || output + matchLength > capacity)
+            return 0;
+
+        /* Byte by byte, a match may overlap the bytes it produces */
+        for(u32int i = 0; i < matchLength; i++, output++)
+            destination[output] = destination[output - offset];
+
+    }
+
+    return output;
+
+}
@@ -15,8 +15,15 @@
 
 #include <Lib/LinkedList.h>
 #include <Memory/HeapMemory.h>
+#include <Memory/Slab.h>
 #include <Debug.h>
 
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE SlabCache* listCache;
+PRIVATE SlabCache* nodeCache;
+
 /*=======================================================
     FUNCTION
 =========================================================*/
@@ -63,7 +70,7 @@ PRIVATE void* LinkedList_removeNode(LinkedList* self, Node* node) {
 
     self->count--;
     void* val = node->data;
-    HeapMemory_free(node);
+    Slab_free(nodeCache, node);
 
     return val;
 
@@ -71,7 +78,10 @@ PRIVATE void* LinkedList_removeNode(LinkedList* self, Node* node) {
 
 PUBLIC void LinkedList_add(LinkedList* self, void* data) {
 
-    Node* node = HeapMemory_calloc(1, sizeof(Node));
+    if(nodeCache == NULL) /* Nodes are packed a few to a cache line, a scheduler queue is walked in order */
+        nodeCache = Slab_createCache("Node", sizeof(Node), 16);
+
+    Node* node = Slab_alloc(nodeCache);
     Debug_assert(node != NULL);
     Debug_assert(data != NULL);
     node->data = data;
@@ -115,7 +125,10 @@ void* LinkedList_getFront(LinkedList* self) {
 
 PUBLIC LinkedList* LinkedList_new() {
 
-    return HeapMemory_calloc(1, sizeof(LinkedList));
+    if(listCache == NULL)
+        listCache = Slab_createCache("LinkedList", sizeof(LinkedList), 0);
+
+    return Slab_alloc(listCache);
 
 }
 
@@ -128,11 +141,11 @@ PUBLIC void LinkedList_destroy(LinkedList* self) {
 
         Node* temp = node;
         node = node->next;
-        HeapMemory_free(temp);
+        Slab_free(nodeCache, temp);
 
     }
 
     /* Free linked list */
-    HeapMemory_free(self);
+    Slab_free(listCache, self);
 
 }
\ No newline at end of file
@@ -17,6 +17,7 @@
 
 #include <Lib/Stack.h>
 #include <Debug.h>
+#include <Memory.h>
 
 PUBLIC void  Stack_push(Stack* self, void* item) {
 
@@ -37,6 +38,24 @@ PUBLIC void* Stack_pop(Stack* self) {
 
 }
 
+PUBLIC void  Stack_pushMany(Stack* self, void** items, u32int count) {
+
+    Debug_assert((self->size + count) * sizeof(void*) <= self->length);
+
+    Memory_copy(self->start + self->size * sizeof(void*), items, count * sizeof(void*));
+    self->size += count;
+
+}
+
+PUBLIC void  Stack_popMany(Stack* self, void** items, u32int count) {
+
+    Debug_assert(self->size >= count);
+
+    self->size -= count;
+    Memory_copy(items, self->start + self->size * sizeof(void*), count * sizeof(void*));
+
+}
+
 PUBLIC void* Stack_peek(Stack* self) {
 
     return (void*) *((int*) (self->start + ((self->size - 1) * sizeof(void*))));
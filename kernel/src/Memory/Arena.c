@@ -0,0 +1,132 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| Arena.c
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Bump allocator for short lived kernel buffers. Memory is
+|               handed out from page chunks and given back all at once.
+|
+|               Chunks are taken from HeapMemory_expand, outside of the
+|               heap manager's free lists. Freed chunks are pooled and
+|               reused, they are never given back to the heap.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#include <Memory/Arena.h>
+#include <Memory/HeapMemory.h>
+#include <Memory/PhysicalMemory.h>
+#include <Process/Scheduler.h>
+#include <Debug.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define ARENA_ALIGN       8
+#define ARENA_CHUNK_SIZE  (2 * FRAME_SIZE) /* Larger requests get a chunk of their own */
+
+/*=======================================================
+    STRUCT
+=========================================================*/
+struct ArenaChunk {
+
+    ArenaChunk* prev; /* Previous chunk of the arena, next chunk in the pool */
+    u32int      size; /* Usable bytes after this header */
+    u32int      padding; /* Keeps the data ARENA_ALIGN aligned */
+
+};
+
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE ArenaChunk* chunkPool;
+PRIVATE Arena       bootScratch;
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/* Chunk with room for "bytes", from the pool if one is large enough */
+PRIVATE ArenaChunk* Arena_getChunk(u32int bytes) {
+
+    for(ArenaChunk** link = &chunkPool; *link != NULL; link = &(*link)->prev) {
+
+        if((*link)->size >= bytes) {
+
+            ArenaChunk* chunk = *link;
+            *link = chunk->prev;
+            return chunk;
+
+        }
+
+    }
+
+    u32int size = ARENA_CHUNK_SIZE;
+
+    if(bytes + sizeof(ArenaChunk) > size)
+        size = (bytes + sizeof(ArenaChunk) + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+
+    ArenaChunk* chunk = HeapMemory_expand(size);
+    chunk->size = size - sizeof(ArenaChunk);
+
+    return chunk;
+
+}
+
+PUBLIC ArenaMark Arena_begin(Arena* arena) {
+
+    ArenaMark mark = {arena->chunk, arena->used};
+
+    return mark;
+
+}
+
+PUBLIC void* Arena_alloc(Arena* arena, u32int bytes) {
+
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    if(arena->chunk == NULL || arena->used + bytes > arena->chunk->size) { /* Start a new chunk, the rest of this one is wasted */
+
+        ArenaChunk* chunk = Arena_getChunk(bytes);
+        chunk->prev = arena->chunk;
+        arena->chunk = chunk;
+        arena->used = 0;
+
+    }
+
+    void* mem = (char*) (arena->chunk + 1) + arena->used;
+    arena->used += bytes;
+
+    return mem;
+
+}
+
+PUBLIC void Arena_reset(Arena* arena, ArenaMark mark) {
+
+    while(arena->chunk != mark.chunk) {
+
+        Debug_assert(arena->chunk != NULL); /* Mark is not from this arena */
+
+        ArenaChunk* chunk = arena->chunk;
+        arena->chunk = chunk->prev;
+        chunk->prev = chunkPool;
+        chunkPool = chunk;
+
+    }
+
+    arena->used = mark.used;
+
+}
+
+PUBLIC Arena* Arena_getScratch(void) {
+
+    Process* current = Scheduler_getCurrentProcess != NULL ? Scheduler_getCurrentProcess() : NULL;
+
+    return current != NULL ? &current->scratch : &bootScratch;
+
+}
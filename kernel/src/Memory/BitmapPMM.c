@@ -26,8 +26,8 @@ PRIVATE u32int totalPhysicalMemory;
 PRIVATE u32int usedFrames;
 PRIVATE u32int totalFrames;
 
-PRIVATE char* frames;
-PRIVATE Bitmap bitmap;
+PRIVATE u32int* frames;
+PRIVATE Bitmap  bitmap;
 
 /*=======================================================
     FUNCTION
@@ -36,46 +36,42 @@ PRIVATE Bitmap bitmap;
 PRIVATE void BitmapPMM_clearRegion(void* regionStart, u32int regionLength) {
 
     u32int frameIndex = (u32int) regionStart / FRAME_SIZE;
+    u32int count = regionLength / FRAME_SIZE;
 
-    for(u32int i = 0; i < regionLength / FRAME_SIZE; i++) {
+    if(frameIndex >= totalFrames)
+        return;
 
-        if(frameIndex + i < totalFrames) {
-            Bitmap_clearBit(&bitmap, frameIndex + i);
-            usedFrames--;
-        } else
-            break;
+    if(frameIndex + count > totalFrames)
+        count = totalFrames - frameIndex;
 
-    }
+    usedFrames -= Bitmap_clearRange(&bitmap, frameIndex, count);
 
 }
 
 PRIVATE void BitmapPMM_setRegion(void* regionStart, u32int regionLength) {
 
     u32int frameIndex = (u32int) regionStart / FRAME_SIZE;
+    u32int count = regionLength / FRAME_SIZE;
 
-    for(u32int i = 0; i < regionLength / FRAME_SIZE; i++) {
+    if(frameIndex >= totalFrames)
+        return;
 
-        if(frameIndex + i < totalFrames) {
-            Bitmap_setBit(&bitmap, frameIndex + i);
-            usedFrames++;
-        } else
-            break;
-    }
+    if(frameIndex + count > totalFrames)
+        count = totalFrames - frameIndex;
+
+    usedFrames += Bitmap_setRange(&bitmap, frameIndex, count);
 
 }
 
 PUBLIC void* BitmapPMM_allocateFrame(void) {
 
-    int frameIndex = 0;
-
     if(usedFrames == totalFrames) /* out of memory */
         return NULL;
 
-    for(u32int i = 0; i < totalFrames; i++)
-        if(!Bitmap_isSet(&bitmap, i)) {
-            frameIndex = i;
-            break;
-        }
+    u32int frameIndex = Bitmap_findFirstClear(&bitmap);
+
+    if(frameIndex == BITMAP_NOT_FOUND || frameIndex >= totalFrames)
+        return NULL;
 
     Bitmap_setBit(&bitmap, frameIndex);
     usedFrames++;
@@ -93,12 +89,82 @@ PUBLIC void BitmapPMM_freeFrame(void* b) {
 
 }
 
+PUBLIC bool BitmapPMM_allocateFrames(u32int n, void** frames) {
+
+    if(totalFrames - usedFrames < n) /* out of memory */
+        return FALSE;
+
+    /* Frame indices are written in place and turned into addresses afterwards */
+    u32int* indices = (u32int*) frames;
+    u32int found = Bitmap_setFirstClear(&bitmap, n, indices);
+    Debug_assert(found == n);
+    usedFrames += n;
+
+    for(u32int i = 0; i < n; i++)
+        frames[i] = (void*) (indices[i] * FRAME_SIZE);
+
+    return TRUE;
+
+}
+
+PUBLIC void BitmapPMM_freeFrames(u32int n, void** frames) {
+
+    for(u32int i = 0; i < n; i++) {
+
+        Debug_assert(frames[i] != NULL);
+        Bitmap_clearBit(&bitmap, (u32int) frames[i] / FRAME_SIZE);
+
+    }
+
+    usedFrames -= n;
+
+}
+
+PUBLIC void* BitmapPMM_allocateBlock(u32int order) {
+
+    u32int blockFrames = 1 << order;
+
+    if(order > PMM_MAX_ORDER || totalFrames - usedFrames < blockFrames) /* out of memory */
+        return NULL;
+
+    u32int first = Bitmap_findFirstClear(&bitmap);
+
+    if(first == BITMAP_NOT_FOUND)
+        return NULL;
+
+    /* Look for a free run of frames, starting at a multiple of the block size */
+    for(u32int start = first & ~(blockFrames - 1); start + blockFrames <= totalFrames; start += blockFrames) {
+
+        if(Bitmap_countSet(&bitmap, start, blockFrames) == 0) {
+
+            BitmapPMM_setRegion((void*) (start * FRAME_SIZE), blockFrames * FRAME_SIZE);
+            return (void*) (start * FRAME_SIZE);
+
+        }
+
+    }
+
+    return NULL;
+
+}
+
+PUBLIC void BitmapPMM_freeBlock(void* b, u32int order) {
+
+    Debug_assert(b != NULL && order <= PMM_MAX_ORDER);
+    BitmapPMM_clearRegion(b, (1 << order) * FRAME_SIZE);
+
+}
+
 PUBLIC PhysicalMemoryInfo* BitmapPMM_getInfo(PhysicalMemoryInfo* buf) {
 
     buf->totalMemory = totalPhysicalMemory;
     buf->totalFrames = totalFrames;
     buf->freeFrames = totalFrames - usedFrames;
 
+    /* Runs of free frames are not tracked, report every frame as a block of its own */
+    Memory_set(buf->freeBlocks, 0, sizeof(buf->freeBlocks));
+    buf->freeBlocks[0] = totalFrames - usedFrames;
+
     return buf;
 
 }
@@ -124,10 +190,15 @@ PUBLIC void BitmapPMM_init(void) {
     }
 
     totalFrames = totalPhysicalMemory / FRAME_SIZE; /* total number of frames = physical memory / 4kB */
-    frames = (char*) kernelEnd; /* put frames array at the end of kernel */
+    u32int bitmapLength = ((totalFrames + 31) / 32) * sizeof(u32int);
+    u32int summaryLength = Bitmap_getSummaryLength(bitmapLength);
+
+    /* put frames bitmap and its summary at the end of kernel */
+    frames = (u32int*) ((kernelEnd + sizeof(u32int) - 1) & ~(sizeof(u32int) - 1));
     usedFrames = totalFrames;
-    Memory_set(frames, 1, (totalFrames / 8) + 1);/* initially set all frames as used */
-    Bitmap_init(&bitmap, frames, (totalFrames / 8) + 1);
+    Memory_set(frames, 0xFF, bitmapLength); /* initially set all frames as used */
+    Bitmap_init(&bitmap, frames, bitmapLength);
+    Bitmap_initSummary(&bitmap, (char*) frames + bitmapLength);
 
     entry = (MultibootMemEntry*) multibootInfo->mmapAddr;
 
@@ -140,10 +211,11 @@ PUBLIC void BitmapPMM_init(void) {
         entry++;
     }
 
-    /* set kernel + frames array + 1 frame(to be safe) as reserved/used */
-    u32int reserved = (kernelEnd - mbHead.loadAddr) + ((totalFrames / 8) + 1) + FRAME_SIZE;
+    /* set kernel + frames bitmap + summary as reserved/used */
+    u32int reservedEnd = (u32int) frames + bitmapLength + summaryLength;
+    u32int reserved = ((reservedEnd - mbHead.loadAddr) + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
     BitmapPMM_setRegion((void*) mbHead.loadAddr, reserved);
 
-    BitmapPMM_allocateFrame(); /* reserve frame starting at address 0(NULL) */
+    BitmapPMM_setRegion(NULL, FRAME_SIZE); /* reserve frame starting at address 0(NULL) */
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,307 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| BuddyPMM.c (implements PhysicalMemory)
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Binary buddy physical memory manager implementation.
+|
+|               Free memory is kept in PMM_MAX_ORDER + 1 free lists, list n
+|               holds free blocks of (2^n) frames. A block of order n always
+|               starts at a frame index which is a multiple of 2^n, so the
+|               buddy of a block is found by flipping bit n of its index.
+|
+|               Book keeping is stored out of band(right after the kernel),
+|               free frames themselves are never touched as they are not
+|               necessarily mapped.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#include <Memory/BuddyPMM.h>
+#include <Debug.h>
+#include <Memory.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+
+/* Frame 0 is never handed out, so index 0 doubles as the list terminator */
+#define BUDDY_NIL       0
+
+/* Order value of a frame that is not the head of a free block */
+#define BUDDY_NOT_FREE  0xFF
+
+/* Buddy book keeping must be reachable after paging is enabled */
+#define IDENTITY_MAP_END 0x400000
+
+/*=======================================================
+    STRUCT
+=========================================================*/
+typedef struct BuddyLink BuddyLink;
+
+/* Free list links of a free block, indexed by the block's first frame */
+struct BuddyLink {
+
+    u32int next;
+    u32int prev;
+
+};
+
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE u32int totalPhysicalMemory;
+PRIVATE u32int totalFrames;
+PRIVATE u32int freeFrames;
+
+PRIVATE BuddyLink* links;     /* one entry per frame */
+PRIVATE u8int*     orders;    /* one entry per frame, order of the free block starting at this frame */
+PRIVATE u32int     freeLists[PMM_MAX_ORDER + 1];
+PRIVATE u32int     freeBlocks[PMM_MAX_ORDER + 1];
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+PRIVATE void BuddyPMM_push(u32int index, u32int order) {
+
+    links[index].prev = BUDDY_NIL;
+    links[index].next = freeLists[order];
+
+    if(freeLists[order] != BUDDY_NIL)
+        links[freeLists[order]].prev = index;
+
+    freeLists[order] = index;
+    orders[index] = order;
+    freeBlocks[order]++;
+
+}
+
+PRIVATE void BuddyPMM_remove(u32int index, u32int order) {
+
+    Debug_assert(orders[index] == order);
+
+    if(links[index].prev != BUDDY_NIL)
+        links[links[index].prev].next = links[index].next;
+    else
+        freeLists[order] = links[index].next;
+
+    if(links[index].next != BUDDY_NIL)
+        links[links[index].next].prev = links[index].prev;
+
+    orders[index] = BUDDY_NOT_FREE;
+    freeBlocks[order]--;
+
+}
+
+/* Frees every frame in [start, end) using the largest aligned blocks possible */
+PRIVATE void BuddyPMM_freeRange(u32int start, u32int end) {
+
+    while(start < end) {
+
+        u32int order = PMM_MAX_ORDER;
+
+        while(order > 0 && (start % (1 << order) != 0 || start + (1 << order) > end))
+            order--;
+
+        BuddyPMM_freeBlock((void*) (start * FRAME_SIZE), order);
+        start += 1 << order;
+
+    }
+
+}
+
+PUBLIC void* BuddyPMM_allocateBlock(u32int order) {
+
+    if(order > PMM_MAX_ORDER)
+        return NULL;
+
+    /* Find the smallest free block that is big enough */
+    u32int current = order;
+
+    while(current <= PMM_MAX_ORDER && freeLists[current] == BUDDY_NIL)
+        current++;
+
+    if(current > PMM_MAX_ORDER) /* out of memory */
+        return NULL;
+
+    u32int index = freeLists[current];
+    BuddyPMM_remove(index, current);
+
+    /* Split it, giving back the upper halves */
+    while(current > order) {
+
+        current--;
+        BuddyPMM_push(index + (1 << current), current);
+
+    }
+
+    freeFrames -= 1 << order;
+    return (void*) (index * FRAME_SIZE);
+
+}
+
+PUBLIC void BuddyPMM_freeBlock(void* b, u32int order) {
+
+    u32int index = (u32int) b / FRAME_SIZE;
+
+    Debug_assert(b != NULL && (u32int) b % FRAME_SIZE == 0);
+    Debug_assert(order <= PMM_MAX_ORDER && index % (1 << order) == 0);
+    Debug_assert(index + (1 << order) <= totalFrames);
+
+    freeFrames += 1 << order;
+
+    /* Merge with buddy while it is a free block of the same order */
+    while(order < PMM_MAX_ORDER) {
+
+        u32int buddy = index ^ (1 << order);
+
+        if(buddy >= totalFrames || orders[buddy] != order)
+            break;
+
+        BuddyPMM_remove(buddy, order);
+
+        if(buddy < index)
+            index = buddy;
+
+        order++;
+
+    }
+
+    BuddyPMM_push(index, order);
+
+}
+
+PUBLIC void* BuddyPMM_allocateFrame(void) {
+
+    return BuddyPMM_allocateBlock(0);
+
+}
+
+PUBLIC void BuddyPMM_freeFrame(void* b) {
+
+    BuddyPMM_freeBlock(b, 0);
+
+}
+
+PUBLIC bool BuddyPMM_allocateFrames(u32int n, void** frames) {
+
+    if(freeFrames < n) /* out of memory */
+        return FALSE;
+
+    u32int count = 0;
+
+    /* Take whole free blocks first, largest that still fit, split only for the remainder */
+    for(int order = PMM_MAX_ORDER; order >= 0 && count < n; order--) {
+
+        while(freeLists[order] != BUDDY_NIL && n - count >= (u32int) (1 << order)) {
+
+            u32int index = freeLists[order];
+            BuddyPMM_remove(index, order);
+
+            for(u32int i = 0; i < (u32int) (1 << order); i++)
+                frames[count++] = (void*) ((index + i) * FRAME_SIZE);
+
+        }
+
+    }
+
+    freeFrames -= count;
+
+    while(count < n)
+        frames[count++] = BuddyPMM_allocateBlock(0);
+
+    return TRUE;
+
+}
+
+PUBLIC void BuddyPMM_freeFrames(u32int n, void** frames) {
+
+    for(u32int i = 0; i < n; i++)
+        BuddyPMM_freeBlock(frames[i], 0);
+
+}
+
+PUBLIC void BuddyPMM_init(void) {
+
+    extern MultibootHeader mbHead; /* Defined in Start.s */
+    extern MultibootInfo* multibootInfo; /* Defined in Kernel.c */
+
+    MultibootMemEntry* entry = (MultibootMemEntry*) multibootInfo->mmapAddr;
+    u32int initrdEnd = *(u32int*)(multibootInfo->modsAddr + 4);
+    u32int kernelEnd = mbHead.bssEndAddr;
+
+    if(initrdEnd != 0)
+        kernelEnd = initrdEnd;
+
+    /* calculate total physical memory */
+    while((u32int) entry <  multibootInfo->mmapAddr + multibootInfo->mmapLength) {
+
+        totalPhysicalMemory += entry->len;
+        entry++;
+
+    }
+
+    totalFrames = totalPhysicalMemory / FRAME_SIZE; /* total number of frames = physical memory / 4kB */
+
+    /* put book keeping at the end of kernel, links first to keep them aligned */
+    kernelEnd = (kernelEnd + sizeof(BuddyLink) - 1) & ~(sizeof(BuddyLink) - 1);
+    links = (BuddyLink*) kernelEnd;
+    orders = (u8int*) (links + totalFrames);
+    u32int reservedEnd = (u32int) (orders + totalFrames);
+
+    Debug_assert(reservedEnd <= IDENTITY_MAP_END);
+    Memory_set(orders, BUDDY_NOT_FREE, totalFrames);
+
+    for(u32int i = 0; i <= PMM_MAX_ORDER; i++)
+        freeLists[i] = BUDDY_NIL;
+
+    /* Free usable frames, frame 0(Starting at address 0) + Kernel + book keeping is reserved */
+    u32int reservedStartIndex = mbHead.loadAddr / FRAME_SIZE;
+    u32int reservedEndIndex = (reservedEnd + FRAME_SIZE - 1) / FRAME_SIZE;
+    entry = (MultibootMemEntry*) multibootInfo->mmapAddr;
+
+    while((u32int) entry <  multibootInfo->mmapAddr + multibootInfo->mmapLength) {
+
+        if(entry->type == MULTIBOOT_MEMORY_AVAILABLE && entry->addr < (u64int) totalFrames * FRAME_SIZE) {
+
+            u32int start = ((u32int) entry->addr + FRAME_SIZE - 1) / FRAME_SIZE;
+            u32int end = (entry->addr + entry->len) / FRAME_SIZE;
+
+            if(end > totalFrames)
+                end = totalFrames;
+
+            if(start == 0)
+                start = 1;
+
+            /* Free the parts outside of the reserved kernel region */
+            if(start < reservedStartIndex)
+                BuddyPMM_freeRange(start, end < reservedStartIndex ? end : reservedStartIndex);
+
+            if(end > reservedEndIndex)
+                BuddyPMM_freeRange(start > reservedEndIndex ? start : reservedEndIndex, end);
+
+        }
+
+        entry++;
+    }
+
+}
+
+PUBLIC PhysicalMemoryInfo* BuddyPMM_getInfo(PhysicalMemoryInfo* buf) {
+
+    buf->totalMemory = totalPhysicalMemory;
+    buf->totalFrames = totalFrames;
+    buf->freeFrames = freeFrames;
+
+    for(u32int i = 0; i <= PMM_MAX_ORDER; i++)
+        buf->freeBlocks[i] = freeBlocks[i];
+
+    return buf;
+
+}
@@ -17,19 +17,77 @@
 #include <Memory/HeapMemory.h>
 #include <Memory/VirtualMemory.h>
 #include <Memory/PhysicalMemory.h>
+#include <Memory/Slab.h>
 #include <Memory.h>
 #include <Debug.h>
 #include <Process/Scheduler.h>
 
-/* Include Heap manager implementation */
+/* Include Heap manager implementation, '-D HEAP_TLSF' selects TLSF(bounded time) over DougLea */
 /* #include <Memory/DumbHeapManager.h> */
+#ifdef HEAP_TLSF
+#include <Memory/TLSF.h>
+#define HEAP_MANAGER(function) TLSF_##function
+#else
 #include <Memory/DougLea.h>
+#define HEAP_MANAGER(function) DougLea_##function
+#endif
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+
+/* Frames requested from the PMM per transaction, bounded as the array lives on the kernel stack */
+#define HEAP_FRAME_BATCH 64
+
+/* Allocation profiler, compiled in with '-D HEAP_PROFILE' */
+#define PROFILE_BUCKETS      13 /* Size histogram, powers of two from 16 bytes, the last bucket holds everything over 32KB */
+#define PROFILE_SITES        64 /* Call sites tracked, later ones are counted in the last entry */
+#define PROFILE_REPORT_LINES 8  /* Call sites printed per report */
+
+/*=======================================================
+    STRUCT
+=========================================================*/
+#ifdef HEAP_PROFILE
+typedef struct HeapBlock HeapBlock;
+typedef struct HeapSite  HeapSite;
+
+/* Header in front of every profiled allocation, keeps the 8 byte alignment of the heap managers */
+struct HeapBlock {
+
+    HeapBlock* prev;
+    HeapBlock* next;
+    u32int     size;   /* Bytes requested */
+    HeapSite*  site;
+    u32int     pid;    /* Owner, see HeapMemory_setOwner */
+    bool       leaked; /* Still allocated after its process was destroyed */
+
+};
+
+struct HeapSite {
+
+    void*  address;     /* Return address of the allocation call, NULL for the overflow entry */
+    u32int liveBytes;
+    u32int liveBlocks;
+    u32int allocations;
+
+};
+#endif
 
 /*=======================================================
     PRIVATE DATA
 =========================================================*/
 PRIVATE Module heapModule;
 PRIVATE char*  kernelHeapTop;
+PRIVATE u32int owner = HEAP_OWNER_RUNNING; /* See HeapMemory_setOwner */
+
+#ifdef HEAP_PROFILE
+PRIVATE HeapBlock* liveList; /* Every live allocation, newest first */
+PRIVATE HeapSite   sites[PROFILE_SITES];
+PRIVATE u32int     histogram[PROFILE_BUCKETS];
+PRIVATE u32int     liveBytes;
+PRIVATE u32int     liveBlocks;
+PRIVATE u32int     peakBytes;
+#endif
 
 /*=======================================================
     PUBLIC DATA
@@ -43,6 +101,201 @@ PUBLIC void  (*HeapMemory_free)    (void* mem);
     FUNCTION
 =========================================================*/
 
+#ifdef HEAP_PROFILE
+/* Call site entry of a return address, the last entry once the table is full */
+PRIVATE HeapSite* HeapMemory_getSite(void* address) {
+
+    for(u32int i = 0; i < PROFILE_SITES - 1; i++) {
+
+        if(sites[i].address == address)
+            return &sites[i];
+
+        if(sites[i].address == NULL) {
+
+            sites[i].address = address;
+            return &sites[i];
+
+        }
+
+    }
+
+    return &sites[PROFILE_SITES - 1];
+
+}
+
+/* Process id new allocations are charged to */
+PRIVATE u32int HeapMemory_getOwner(void) {
+
+    if(owner != HEAP_OWNER_RUNNING)
+        return owner;
+
+    Process* current = Scheduler_getCurrentProcess != NULL ? Scheduler_getCurrentProcess() : NULL;
+
+    return current != NULL ? current->pid : KERNEL_PID;
+
+}
+
+/* Links a fresh block into the profile, returns the memory handed to the caller */
+PRIVATE void* HeapMemory_track(HeapBlock* block, u32int size, void* caller, u32int pid) {
+
+    if(block == NULL)
+        return NULL;
+
+    block->size = size;
+    block->site = HeapMemory_getSite(caller);
+    block->pid = pid;
+    block->leaked = FALSE;
+
+    block->prev = NULL;
+    block->next = liveList;
+    if(liveList != NULL)
+        liveList->prev = block;
+    liveList = block;
+
+    u32int bucket = 0;
+    while(bucket < PROFILE_BUCKETS - 1 && size > (16U << bucket))
+        bucket++;
+
+    histogram[bucket]++;
+    block->site->allocations++;
+    block->site->liveBytes += size;
+    block->site->liveBlocks++;
+    liveBlocks++;
+    liveBytes += size;
+
+    if(liveBytes > peakBytes)
+        peakBytes = liveBytes;
+
+    return block + 1;
+
+}
+
+/* Unlinks a block from the profile */
+PRIVATE void HeapMemory_untrack(HeapBlock* block) {
+
+    if(block->prev != NULL)
+        block->prev->next = block->next;
+    else
+        liveList = block->next;
+
+    if(block->next != NULL)
+        block->next->prev = block->prev;
+
+    block->site->liveBytes -= block->size;
+    block->site->liveBlocks--;
+    liveBlocks--;
+    liveBytes -= block->size;
+
+}
+
+PRIVATE void* HeapMemory_profileAlloc(size_t bytes) {
+
+    return HeapMemory_track(HEAP_MANAGER(malloc)(bytes + sizeof(HeapBlock)), bytes, __builtin_return_address(0), HeapMemory_getOwner());
+
+}
+
+PRIVATE void* HeapMemory_profileCalloc(size_t numberOfElements, size_t elementSize) {
+
+    if(elementSize != 0 && numberOfElements > (0xFFFFFFFF - sizeof(HeapBlock)) / elementSize) /* Overflow */
+        return NULL;
+
+    u32int bytes = numberOfElements * elementSize;
+
+    return HeapMemory_track(HEAP_MANAGER(calloc)(1, bytes + sizeof(HeapBlock)), bytes, __builtin_return_address(0), HeapMemory_getOwner());
+
+}
+
+PRIVATE void* HeapMemory_profileRealloc(void* oldmem, size_t bytes) {
+
+    if(oldmem == NULL)
+        return HeapMemory_track(HEAP_MANAGER(malloc)(bytes + sizeof(HeapBlock)), bytes, __builtin_return_address(0), HeapMemory_getOwner());
+
+    HeapBlock* block = (HeapBlock*) oldmem - 1;
+    u32int pid = block->pid; /* Growing a table doesn't make it the running process' */
+    HeapMemory_untrack(block);
+
+    HeapBlock* moved = HEAP_MANAGER(realloc)(block, bytes + sizeof(HeapBlock));
+
+    if(moved == NULL) { /* Old block is still valid */
+
+        HeapMemory_track(block, block->size, block->site->address, pid);
+        return NULL;
+
+    }
+
+    return HeapMemory_track(moved, bytes, __builtin_return_address(0), pid);
+
+}
+
+PRIVATE void HeapMemory_profileFree(void* mem) {
+
+    if(mem == NULL)
+        return;
+
+    HeapBlock* block = (HeapBlock*) mem - 1;
+    HeapMemory_untrack(block);
+    HEAP_MANAGER(free)(block);
+
+}
+
+/* Prints the call sites with the most live bytes, "pid" limits it to leaked blocks of one process */
+PRIVATE void HeapMemory_printSites(bool leaksOnly, u32int pid) {
+
+    HeapSite top[PROFILE_REPORT_LINES];
+    Memory_set(top, 0, sizeof(top));
+
+    if(leaksOnly) { /* Totals of the process' blocks only, sites are shared with other processes */
+
+        for(HeapBlock* block = liveList; block != NULL; block = block->next) {
+
+            if(!block->leaked || block->pid != pid)
+                continue;
+
+            u32int i = 0;
+            while(i < PROFILE_REPORT_LINES - 1 && top[i].address != NULL && top[i].address != block->site->address)
+                i++;
+
+            if(top[i].liveBlocks > 0 && top[i].address != block->site->address) /* Out of lines, lump the rest together */
+                top[i].address = NULL;
+            else
+                top[i].address = block->site->address;
+
+            top[i].liveBytes += block->size;
+            top[i].liveBlocks++;
+
+        }
+
+    } else { /* Insertion into the sorted top list */
+
+        for(u32int i = 0; i < PROFILE_SITES; i++) {
+
+            if(sites[i].liveBytes == 0)
+                continue;
+
+            for(u32int y = 0; y < PROFILE_REPORT_LINES; y++) {
+
+                if(sites[i].liveBytes > top[y].liveBytes) {
+
+                    for(u32int z = PROFILE_REPORT_LINES - 1; z > y; z--)
+                        top[z] = top[z - 1];
+
+                    top[y] = sites[i];
+                    break;
+
+                }
+
+            }
+
+        }
+
+    }
+
+    for(u32int i = 0; i < PROFILE_REPORT_LINES && top[i].liveBlocks > 0; i++)
+        Console_printf("%s%d%s%d%s%d%s", "[HEAP]   site ", (u32int) top[i].address, ": ", top[i].liveBytes, " bytes in ", top[i].liveBlocks, " blocks\n");
+
+}
+#endif
+
 PRIVATE void HeapMemory_init(void) {
 
     Debug_logInfo("%s%s", "Initialising ", heapModule.moduleName);
@@ -50,10 +303,17 @@ PRIVATE void HeapMemory_init(void) {
     kernelHeapTop = (void*) KERNEL_HEAP_BASE_VADDR;
 
     /* Point to heap manager implementation */
-    HeapMemory_alloc   = &DougLea_malloc;
-    HeapMemory_realloc = &DougLea_realloc;
-    HeapMemory_calloc  = &DougLea_calloc;
-    HeapMemory_free    = &DougLea_free;
+    HeapMemory_alloc   = &HEAP_MANAGER(malloc);
+    HeapMemory_realloc = &HEAP_MANAGER(realloc);
+    HeapMemory_calloc  = &HEAP_MANAGER(calloc);
+    HeapMemory_free    = &HEAP_MANAGER(free);
+
+#ifdef HEAP_PROFILE
+    HeapMemory_alloc   = &HeapMemory_profileAlloc;
+    HeapMemory_realloc = &HeapMemory_profileRealloc;
+    HeapMemory_calloc  = &HeapMemory_profileCalloc;
+    HeapMemory_free    = &HeapMemory_profileFree;
+#endif
 
 }
 
@@ -67,23 +327,33 @@ PUBLIC void* HeapMemory_expand(ptrdiff_t size) {
 
     if(size >= 0) { /* Expand heap */
 
-        Debug_assert((u32int) kernelHeapTop + size < KERNEL_HEAP_TOP_VADDR); /* heap should not overflow */
+        Debug_assert((u32int) kernelHeapTop + size <= (u32int) VirtualMemory_getKernelHeapLimit()); /* heap should not overflow */
         void* ret = kernelHeapTop;
+        void* frames[HEAP_FRAME_BATCH];
 
-        for(u32int i = 0; i < pages; i++) {
+        while(pages > 0) {
 
-            void* physicalAddress = PhysicalMemory_allocateFrame();
+            u32int batch = pages < HEAP_FRAME_BATCH ? pages : HEAP_FRAME_BATCH;
 
-            if(physicalAddress == NULL) /* Are we out of physical memory? */
-                Sys_panic("Out of physical memory!");
+            /* Pre-zeroed frames first, the rest is zeroed here */
+            u32int zeroed = PhysicalMemory_allocateZeroedFrames(batch, frames);
 
-            if(Scheduler_getCurrentProcess == NULL || Scheduler_getCurrentProcess() == NULL)
-                VirtualMemory_mapPage(VirtualMemory_getKernelDir(), kernelHeapTop, physicalAddress, MODE_KERNEL);
-            else
-                VirtualMemory_mapPage(Scheduler_getCurrentProcess()->pageDir, kernelHeapTop, physicalAddress, MODE_KERNEL);
+            if(!PhysicalMemory_allocateFrames(batch - zeroed, frames + zeroed)) { /* Are we out of physical memory? */
+
+                /* Take frames from cold user pages, only dropping as storing them would need the heap */
+                VirtualMemory_reclaim(batch - zeroed, FALSE);
+
+                if(!PhysicalMemory_allocateFrames(batch - zeroed, frames + zeroed))
+                    Sys_panic("Out of physical memory!");
+
+            }
+
+            /* Kernel page tables are shared, every address space sees the new pages */
+            VirtualMemory_mapRange(VirtualMemory_getKernelDir(), kernelHeapTop, frames, batch, MODE_KERNEL);
+            Memory_set(kernelHeapTop + zeroed * FRAME_SIZE, 0, (batch - zeroed) * FRAME_SIZE); /* Nullify allocated frames */
 
-            Memory_set(kernelHeapTop, 0, FRAME_SIZE); /* Nullify allocated frame */
-            kernelHeapTop += FRAME_SIZE;
+            kernelHeapTop += batch * FRAME_SIZE;
+            pages -= batch;
 
         }
 
@@ -93,19 +363,20 @@ PUBLIC void* HeapMemory_expand(ptrdiff_t size) {
 
         Debug_assert((u32int) kernelHeapTop - size >= KERNEL_HEAP_BASE_VADDR); /* heap should not underflow */
 
-        for(u32int i = 0; i < pages * -1; i++) {
+        void* frames[HEAP_FRAME_BATCH];
+        pages *= -1;
 
-            kernelHeapTop -= FRAME_SIZE;
-            Debug_assert(kernelHeapTop >= (char*) KERNEL_HEAP_BASE_VADDR);
+        while(pages > 0) {
 
-            void* physicalAddress = VirtualMemory_getPhysicalAddress(kernelHeapTop);
-            Debug_assert(physicalAddress != NULL);
-            PhysicalMemory_freeFrame(physicalAddress);
+            Debug_assert(kernelHeapTop > (char*) KERNEL_HEAP_BASE_VADDR);
 
-            if(Scheduler_getCurrentProcess == NULL || Scheduler_getCurrentProcess() == NULL)
-                VirtualMemory_unmapPage(VirtualMemory_getKernelDir(), kernelHeapTop);
-            else
-                VirtualMemory_unmapPage(Scheduler_getCurrentProcess()->pageDir, kernelHeapTop);
+            u32int batch = pages < HEAP_FRAME_BATCH ? pages : HEAP_FRAME_BATCH;
+            kernelHeapTop -= batch * FRAME_SIZE;
+            pages -= batch;
+
+            u32int unmapped = VirtualMemory_unmapRange(VirtualMemory_getKernelDir(), kernelHeapTop, batch, frames);
+            Debug_assert(unmapped == batch);
+            PhysicalMemory_freeFrames(unmapped, frames);
 
         }
 
@@ -130,41 +401,127 @@ PUBLIC void* HeapMemory_expandUser(ptrdiff_t size) {
         Debug_assert((u32int) currentProcess->userHeapTop + size < USER_HEAP_TOP_VADDR); /* heap should not overflow */
         void* ret = currentProcess->userHeapTop;
 
-        for(u32int i = 0; i < pages; i++) {
+        /* Only reserve the range, pages are mapped on first touch by the page fault handler */
+        currentProcess->userHeapTop += size;
+
+        return ret;
+
+    } else { /* Contract heap */
+
+        Debug_assert((u32int) currentProcess->userHeapTop - size >= USER_HEAP_BASE_VADDR); /* heap should not underflow */
+
+        void* frames[HEAP_FRAME_BATCH];
+        pages *= -1;
 
-            void* physicalAddress = PhysicalMemory_allocateFrame();
+        while(pages > 0) {
 
-            if(physicalAddress == NULL) /* Are we out of physical memory? */
-                Sys_panic("Out of physical memory!");
+            u32int batch = pages < HEAP_FRAME_BATCH ? pages : HEAP_FRAME_BATCH;
+            currentProcess->userHeapTop -= batch * FRAME_SIZE;
+            pages -= batch;
 
-            VirtualMemory_mapPage(Scheduler_getCurrentProcess()->pageDir, currentProcess->userHeapTop, physicalAddress, MODE_USER);
+            /* Pages that were never touched are not mapped, skipped */
+            u32int unmapped = VirtualMemory_unmapRange(currentProcess->pageDir, currentProcess->userHeapTop, batch, frames);
+            u32int freed = 0;
 
-            Memory_set(currentProcess->userHeapTop, 0, FRAME_SIZE); /* Nullify allocated frame */
-            currentProcess->userHeapTop += FRAME_SIZE;
+            for(u32int i = 0; i < unmapped; i++)
+                if(PhysicalMemory_dropFrameReference(frames[i])) /* Not used by a forked process */
+                    frames[freed++] = frames[i];
+
+            PhysicalMemory_freeFrames(freed, frames);
 
         }
 
-        return ret;
+        return currentProcess->userHeapTop;
 
-    } else { /* Contract heap */
+    }
 
-        Debug_assert((u32int) currentProcess->userHeapTop - size >= USER_HEAP_BASE_VADDR); /* heap should not underflow */
+}
+
+PUBLIC void HeapMemory_printProfile(void) {
 
-        for(u32int i = 0; i < pages * -1; i++) {
+    /* Slab caches live on the heap, their usage is known with or without the profiler */
+    SlabInfo info;
 
-            currentProcess->userHeapTop -= FRAME_SIZE;
-            Debug_assert((char*) currentProcess->userHeapTop >= (char*) USER_HEAP_BASE_VADDR);
+    for(u32int i = 0; Slab_getCache(i) != NULL; i++) {
 
-            void* physicalAddress = VirtualMemory_getPhysicalAddress(currentProcess->userHeapTop);
-            Debug_assert(physicalAddress != NULL);
-            PhysicalMemory_freeFrame(physicalAddress);
-            VirtualMemory_unmapPage(Scheduler_getCurrentProcess()->pageDir, currentProcess->userHeapTop);
+        Slab_getInfo(Slab_getCache(i), &info);
+        Console_printf("%s%s%s%d%s%d%s", "[SLAB] ", info.name, ": ", info.activeObjects, "/", info.totalObjects, " objects");
+        Console_printf("%s%d%s%d%s%d%s", " of ", info.objectSize, " bytes in ", info.slabs, " slabs, ", info.allocations, " allocations\n");
+
+    }
+
+#ifdef HEAP_PROFILE
+    Console_printf("%s%d%s%d%s%d%s", "[HEAP] live: ", liveBytes, " bytes in ", liveBlocks, " blocks, peak: ", peakBytes, " bytes\n");
+    Console_printf("%s", "[HEAP] allocations by size:");
+
+    for(u32int i = 0; i < PROFILE_BUCKETS; i++)
+        Console_printf("%c%s%d%c%d", ' ', i < PROFILE_BUCKETS - 1 ? "<=" : ">", 16 << (i < PROFILE_BUCKETS - 1 ? i : i - 1), ':', histogram[i]);
+
+    Console_printf("%c", '\n');
+    HeapMemory_printSites(FALSE, 0);
+
+    /* Leaks, blocks are grouped by process */
+    for(HeapBlock* block = liveList; block != NULL; block = block->next) {
+
+        if(!block->leaked)
+            continue;
+
+        /* Only the first block of each process prints its summary */
+        HeapBlock* first = block;
+        for(HeapBlock* other = liveList; other != block; other = other->next)
+            if(other->leaked && other->pid == block->pid)
+                first = other;
+
+        if(first == block) {
+
+            Console_printf("%s%d%s", "[HEAP] leaked by pid ", block->pid, ":\n");
+            HeapMemory_printSites(TRUE, block->pid);
 
         }
 
-        return currentProcess->userHeapTop;
+    }
+#else
+    Console_printf("%s", "Heap profiler is not compiled in, build with -D HEAP_PROFILE\n");
+#endif
+
+}
+
+PUBLIC u32int HeapMemory_setOwner(u32int newOwner) {
+
+    u32int previous = owner;
+    owner = newOwner;
+
+    return previous;
+
+}
+
+PUBLIC void HeapMemory_reportLeaks(u32int pid) {
+
+#ifdef HEAP_PROFILE
+    u32int bytes = 0;
+    u32int blocks = 0;
+
+    for(HeapBlock* block = liveList; block != NULL; block = block->next) {
+
+        if(block->pid == pid && !block->leaked) {
+
+            block->leaked = TRUE;
+            bytes += block->size;
+            blocks++;
+
+        }
+
+    }
+
+    if(blocks > 0) {
+
+        Console_printf("%s%d%s%d%s%d%s", "[HEAP] pid ", pid, " left ", bytes, " bytes in ", blocks, " blocks:\n");
+        HeapMemory_printSites(TRUE, pid);
 
     }
+#else
+    UNUSED(pid);
+#endif
 
 }
 
@@ -15,24 +15,53 @@
 
 
 #include <Memory/PhysicalMemory.h>
+#include <Memory/VirtualMemory.h>
+#include <Memory/HeapMemory.h>
+#include <Memory.h>
+#include <Lib/Stack.h>
 #include <Debug.h>
+#include <Sys.h>
+#include <X86/CPU.h>
 
 /* Include PMM implementation */
 /* #include Memory/BitmapPMM.h */
+/* #include Memory/BuddyPMM.h */
 #include <Memory/StackPMM.h>
 
 
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define ZERO_POOL_SIZE      32  /* Maximum number of pre-zeroed frames */
+#define ZERO_POOL_MIN_FREE  256 /* Stop refilling when fewer frames are free */
+
+/* Idle process zeroes at the first page, allocateZeroedFrame at the second */
+#define ZERO_POOL_IDLE_VADDR  ((void*) ZERO_POOL_MAP_VADDR)
+#define ZERO_POOL_MISS_VADDR  ((void*) (ZERO_POOL_MAP_VADDR + FRAME_SIZE))
+
 /*=======================================================
     PRIVATE DATA
 =========================================================*/
 PRIVATE Module pmmModule;
 
+PRIVATE void*  zeroPoolFrames[ZERO_POOL_SIZE];
+PRIVATE Stack  zeroPool;
+PRIVATE u32int zeroPoolHits;
+PRIVATE u32int zeroPoolMisses;
+
+/* Extra references per frame(0 = single owner), allocated when a frame is first shared */
+PRIVATE u16int* frameReferences;
+
 /*=======================================================
     PUBLIC DATA
 =========================================================*/
 PUBLIC PhysicalMemoryInfo*  (*PhysicalMemory_getInfo) (PhysicalMemoryInfo* buf);
 PUBLIC void* (*PhysicalMemory_allocateFrame) (void);
 PUBLIC void  (*PhysicalMemory_freeFrame) (void* frame);
+PUBLIC bool  (*PhysicalMemory_allocateFrames) (u32int n, void** frames);
+PUBLIC void  (*PhysicalMemory_freeFrames) (u32int n, void** frames);
+PUBLIC void* (*PhysicalMemory_allocateBlock) (u32int order);
+PUBLIC void  (*PhysicalMemory_freeBlock) (void* block, u32int order);
 
 /*=======================================================
     FUNCTION
@@ -46,9 +75,154 @@ PRIVATE void _PhysicalMemory_init() {
     PhysicalMemory_getInfo       = StackPMM_getInfo;
     PhysicalMemory_allocateFrame = StackPMM_allocateFrame;
     PhysicalMemory_freeFrame     = StackPMM_freeFrame;
+    PhysicalMemory_allocateFrames = StackPMM_allocateFrames;
+    PhysicalMemory_freeFrames    = StackPMM_freeFrames;
+    PhysicalMemory_allocateBlock = StackPMM_allocateBlock;
+    PhysicalMemory_freeBlock     = StackPMM_freeBlock;
 
     /* Call PMM init function */
+#ifdef BENCHMARK
+    u64int begin = CPU_readTimestamp();
+#endif
+
     StackPMM_init();
+    Stack_init(&zeroPool, zeroPoolFrames, sizeof(zeroPoolFrames));
+
+#ifdef BENCHMARK
+    PhysicalMemoryInfo info;
+    PhysicalMemory_getInfo(&info);
+    Console_printf("%s%d%s%d%s", "[BENCH] PMM init took ", (u32int) (CPU_readTimestamp() - begin), " cycles for ", info.freeFrames, " free frames\n");
+#endif
+
+}
+
+PRIVATE void PhysicalMemory_zeroFrame(void* frame, void* virtualAddr) {
+
+    void* page = VirtualMemory_mapFrame(frame, virtualAddr);
+    Memory_set(page, 0, FRAME_SIZE);
+    VirtualMemory_unmapFrame(page);
+
+}
+
+PUBLIC void* PhysicalMemory_allocateZeroedFrame(void) {
+
+    if(zeroPool.size > 0) {
+
+        zeroPoolHits++;
+        return Stack_pop(&zeroPool);
+
+    }
+
+    zeroPoolMisses++;
+    void* frame = PhysicalMemory_allocateFrame();
+
+    if(frame != NULL)
+        PhysicalMemory_zeroFrame(frame, ZERO_POOL_MISS_VADDR);
+
+    return frame;
+
+}
+
+PUBLIC u32int PhysicalMemory_allocateZeroedFrames(u32int n, void** frames) {
+
+    u32int count = zeroPool.size < n ? zeroPool.size : n;
+
+    Stack_popMany(&zeroPool, frames, count);
+    zeroPoolHits += count;
+    zeroPoolMisses += n - count;
+
+    return count;
+
+}
+
+PUBLIC bool PhysicalMemory_refillZeroedPool(void) {
+
+    PhysicalMemoryInfo info;
+
+    /* Pool is shared with syscalls and IRQs, only the zeroing itself is done with interrupts on */
+    Sys_disableInterrupts();
+
+    if(zeroPool.size == ZERO_POOL_SIZE || PhysicalMemory_getInfo(&info)->freeFrames < ZERO_POOL_MIN_FREE) {
+
+        Sys_enableInterrupts();
+        return FALSE;
+
+    }
+
+    void* frame = PhysicalMemory_allocateFrame();
+    Debug_assert(frame != NULL);
+    void* page = VirtualMemory_mapFrame(frame, ZERO_POOL_IDLE_VADDR);
+    Sys_enableInterrupts();
+
+    Memory_set(page, 0, FRAME_SIZE);
+
+    Sys_disableInterrupts();
+    VirtualMemory_unmapFrame(page);
+    Stack_push(&zeroPool, frame);
+    Sys_enableInterrupts();
+
+    return TRUE;
+
+}
+
+PUBLIC void PhysicalMemory_addFrameReference(void* frame) {
+
+    Debug_assert(frame != NULL && (u32int) frame % FRAME_SIZE == 0);
+
+    if(frameReferences == NULL) {
+
+        PhysicalMemoryInfo info;
+        u32int owner = HeapMemory_setOwner(HEAP_OWNER_KERNEL); /* First fork allocates it, every process uses it */
+        frameReferences = HeapMemory_calloc(PhysicalMemory_getInfo(&info)->totalFrames, sizeof(u16int));
+        HeapMemory_setOwner(owner);
+        Debug_assert(frameReferences != NULL);
+
+    }
+
+    u32int index = (u32int) frame / FRAME_SIZE;
+    Debug_assert(frameReferences[index] != 0xFFFF);
+    frameReferences[index]++;
+
+}
+
+PUBLIC bool PhysicalMemory_dropFrameReference(void* frame) {
+
+    u32int index = (u32int) frame / FRAME_SIZE;
+
+    if(frameReferences == NULL || frameReferences[index] == 0)
+        return TRUE;
+
+    frameReferences[index]--;
+    return FALSE;
+
+}
+
+PUBLIC bool PhysicalMemory_isFrameShared(void* frame) {
+
+    return frameReferences != NULL && frameReferences[(u32int) frame / FRAME_SIZE] != 0;
+
+}
+
+PUBLIC ZeroPoolInfo* PhysicalMemory_getZeroPoolInfo(ZeroPoolInfo* buf) {
+
+    buf->frames = zeroPool.size;
+    buf->hits = zeroPoolHits;
+    buf->misses = zeroPoolMisses;
+
+    return buf;
+
+}
+
+PUBLIC void PhysicalMemory_printInfo(void) {
+
+    PhysicalMemoryInfo info;
+    ZeroPoolInfo pool;
+
+    PhysicalMemory_getInfo(&info);
+    PhysicalMemory_getZeroPoolInfo(&pool);
+
+    Console_printf("%s%d%s%d%s", "[PMM] free frames: ", info.freeFrames, " of ", info.totalFrames, "\n");
+    Console_printf("%s%d%s%d%s%d%s", "[PMM] zero pool: ", pool.frames, " frames, ", pool.hits, " hits, ", pool.misses, " misses\n");
 
 }
 
@@ -0,0 +1,175 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| Slab.c
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Object caches for fixed size kernel objects, built on top
+|               of the kernel heap.
+|
+|               A slab is a block of the kernel heap cut into objects of
+|               one size. The first word of a slab links it to the next
+|               slab of the cache, the first word of a free object links
+|               it to the next free object. Allocating and freeing are a
+|               list pop and push.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#include <Memory/Slab.h>
+#include <Memory/HeapMemory.h>
+#include <Memory/PhysicalMemory.h>
+#include <Memory.h>
+#include <Debug.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define SLAB_MIN_OBJECTS 8 /* Slabs are a page, or larger to hold at least this many objects */
+
+/*=======================================================
+    STRUCT
+=========================================================*/
+struct SlabCache {
+
+    const char* name;
+    u32int      objectSize;
+    u32int      align;
+    u32int      slabSize;
+
+    void*       freeList; /* Free objects */
+    void*       slabs;    /* Every slab of the cache */
+
+    u32int      slabCount;
+    u32int      totalObjects;
+    u32int      activeObjects;
+    u32int      allocations;
+
+    SlabCache*  next; /* Next cache, see Slab_getCache */
+
+};
+
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE SlabCache* caches;
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/* Adds a slab to a cache, returns FALSE if the heap is out of memory */
+PRIVATE bool Slab_grow(SlabCache* cache) {
+
+    u32int owner = HeapMemory_setOwner(HEAP_OWNER_KERNEL); /* Slabs outlive the process that made them grow */
+    char* slab = HeapMemory_alloc(cache->slabSize);
+    HeapMemory_setOwner(owner);
+
+    if(slab == NULL)
+        return FALSE;
+
+    *(void**) slab = cache->slabs;
+    cache->slabs = slab;
+    cache->slabCount++;
+
+    /* Objects start at the first aligned address past the link */
+    char* first = (char*) (((u32int) slab + sizeof(void*) + cache->align - 1) & ~(cache->align - 1));
+    u32int count = (slab + cache->slabSize - first) / cache->objectSize;
+
+    /* Pushed last to first, so they are handed out in address order */
+    for(u32int i = count; i > 0; i--) {
+
+        void** object = (void**) (first + (i - 1) * cache->objectSize);
+        *object = cache->freeList;
+        cache->freeList = object;
+
+    }
+
+    cache->totalObjects += count;
+
+    return TRUE;
+
+}
+
+PUBLIC SlabCache* Slab_createCache(const char* name, u32int size, u32int align) {
+
+    if(align == 0)
+        align = CACHE_LINE_SIZE;
+
+    Debug_assert(size > 0 && (align & (align - 1)) == 0);
+
+    u32int owner = HeapMemory_setOwner(HEAP_OWNER_KERNEL);
+    SlabCache* cache = HeapMemory_calloc(1, sizeof(SlabCache));
+    HeapMemory_setOwner(owner);
+    Debug_assert(cache != NULL);
+
+    if(size < sizeof(void*)) /* Free objects hold a link */
+        size = sizeof(void*);
+
+    cache->name = name;
+    cache->align = align;
+    cache->objectSize = (size + align - 1) & ~(align - 1);
+
+    /* Room for the link, the padding before the first object and SLAB_MIN_OBJECTS objects */
+    cache->slabSize = (sizeof(void*) + align + cache->objectSize * SLAB_MIN_OBJECTS + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+
+    cache->next = caches;
+    caches = cache;
+
+    return cache;
+
+}
+
+PUBLIC void* Slab_alloc(SlabCache* cache) {
+
+    if(cache->freeList == NULL && !Slab_grow(cache))
+        return NULL;
+
+    void** object = cache->freeList;
+    cache->freeList = *object;
+    cache->activeObjects++;
+    cache->allocations++;
+
+    Memory_set(object, 0, cache->objectSize);
+
+    return object;
+
+}
+
+PUBLIC void Slab_free(SlabCache* cache, void* object) {
+
+    Debug_assert(object != NULL && cache->activeObjects > 0);
+
+    *(void**) object = cache->freeList;
+    cache->freeList = object;
+    cache->activeObjects--;
+
+}
+
+PUBLIC SlabInfo* Slab_getInfo(SlabCache* cache, SlabInfo* buf) {
+
+    buf->name = cache->name;
+    buf->objectSize = cache->objectSize;
+    buf->slabs = cache->slabCount;
+    buf->totalObjects = cache->totalObjects;
+    buf->activeObjects = cache->activeObjects;
+    buf->allocations = cache->allocations;
+
+    return buf;
+
+}
+
+PUBLIC SlabCache* Slab_getCache(u32int index) {
+
+    SlabCache* cache = caches;
+
+    while(cache != NULL && index-- > 0)
+        cache = cache->next;
+
+    return cache;
+
+}
@@ -9,6 +9,12 @@
 |
 | DESCRIPTION:  Stack based physical memory manager implementation.
 |
+|               Untouched memory is kept as a few (base, count) ranges taken
+|               from the multiboot memory map, frames are carved off them on
+|               demand. Only freed frames go on the stack, so boot time does
+|               not depend on the amount of RAM. Compile with
+|               '-D STACK_PMM_EAGER' to push every frame at boot instead.
+|
 | AUTHOR:       Ali Ersenal, aliersenal@gmail.com
 \------------------------------------------------------------------------*/
 
@@ -19,6 +25,24 @@
 #include <Memory.h>
 
 
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define STACK_PMM_MAX_RANGES 32
+
+/*=======================================================
+    STRUCT
+=========================================================*/
+typedef struct FrameRange FrameRange;
+
+/* Run of free frames that were never handed out */
+struct FrameRange {
+
+    u32int base;  /* Address of first frame */
+    u32int count; /* Number of frames left */
+
+};
+
 /*=======================================================
     PRIVATE DATA
 =========================================================*/
@@ -26,16 +50,65 @@ PRIVATE u32int totalPhysicalMemory;
 PRIVATE u32int totalFrames;
 PRIVATE Stack  stack;
 
+PRIVATE FrameRange ranges[STACK_PMM_MAX_RANGES];
+PRIVATE u32int     numberOfRanges;
+PRIVATE u32int     rangeFrames; /* Frames left in all ranges */
+
 /*=======================================================
     FUNCTION
 =========================================================*/
 
+/* Takes "n" frames off the highest range(s) */
+PRIVATE void StackPMM_carve(u32int n, void** frames) {
+
+    Debug_assert(n <= rangeFrames);
+    rangeFrames -= n;
+
+    while(n > 0) {
+
+        FrameRange* range = &ranges[numberOfRanges - 1];
+
+        range->count--;
+        *frames++ = (void*) (range->base + range->count * FRAME_SIZE);
+        n--;
+
+        if(range->count == 0)
+            numberOfRanges--;
+
+    }
+
+}
+
+/* Adds usable frames [start, end) to the free frames */
+PRIVATE void StackPMM_addRange(u32int start, u32int end) {
+
+    if(start >= end)
+        return;
+
+#ifdef STACK_PMM_EAGER
+    for(u32int frame = start; frame < end; frame++)
+        Stack_push(&stack, (void*) (frame * FRAME_SIZE));
+#else
+    Debug_assert(numberOfRanges < STACK_PMM_MAX_RANGES);
+
+    ranges[numberOfRanges].base = start * FRAME_SIZE;
+    ranges[numberOfRanges].count = end - start;
+    numberOfRanges++;
+    rangeFrames += end - start;
+#endif
+
+}
+
 PUBLIC void* StackPMM_allocateFrame(void) {
 
-    if(stack.size == 0) /* out of memory */
+    if(stack.size > 0) /* Recently freed frames first */
+        return Stack_pop(&stack);
+
+    if(rangeFrames == 0) /* out of memory */
         return NULL;
 
-    void* frame = Stack_pop(&stack);
+    void* frame;
+    StackPMM_carve(1, &frame);
     return frame;
 }
 
@@ -46,6 +119,45 @@ PUBLIC void StackPMM_freeFrame(void* b) {
 
 }
 
+PUBLIC bool StackPMM_allocateFrames(u32int n, void** frames) {
+
+    if(stack.size + rangeFrames < n) /* out of memory */
+        return FALSE;
+
+    u32int stacked = stack.size < n ? stack.size : n;
+
+    Stack_popMany(&stack, frames, stacked);
+    StackPMM_carve(n - stacked, frames + stacked);
+    return TRUE;
+
+}
+
+PUBLIC void StackPMM_freeFrames(u32int n, void** frames) {
+
+    for(u32int i = 0; i < n; i++)
+        Debug_assert(frames[i] != NULL && (u32int) frames[i] % FRAME_SIZE == 0);
+
+    Stack_pushMany(&stack, frames, n);
+
+}
+
+PUBLIC void* StackPMM_allocateBlock(u32int order) {
+
+    /* Stacked frames are in no particular order, can't hand out contiguous blocks */
+    if(order != 0)
+        return NULL;
+
+    return StackPMM_allocateFrame();
+
+}
+
+PUBLIC void StackPMM_freeBlock(void* b, u32int order) {
+
+    for(u32int i = 0; i < (u32int) (1 << order); i++)
+        StackPMM_freeFrame((char*) b + i * FRAME_SIZE);
+
+}
+
 PUBLIC void StackPMM_init(void) {
 
     extern MultibootHeader mbHead; /* Defined in Start.s */
@@ -68,24 +180,28 @@ PUBLIC void StackPMM_init(void) {
 
     totalFrames = totalPhysicalMemory / FRAME_SIZE; /* total number of frames = physical memory / 4kB */
     Stack_init(&stack, (char*) kernelEnd, totalFrames * sizeof(void *));
+
+    /* Frame 0(Starting at address 0) + Kernel + PMM stack is reserved */
+    u32int reservedStartIndex = mbHead.loadAddr / FRAME_SIZE;
+    u32int reservedEndIndex = (kernelEnd + totalFrames * sizeof(void *) + FRAME_SIZE - 1) / FRAME_SIZE;
     entry = (MultibootMemEntry*) multibootInfo->mmapAddr;
 
-    /* Push usable frames to stack */
+    /* Add usable regions */
     while((u32int) entry <  multibootInfo->mmapAddr + multibootInfo->mmapLength) {
 
-        if(entry->type == MULTIBOOT_MEMORY_AVAILABLE) {
-
-            u32int numberOfFrames = entry->len / FRAME_SIZE;
+        if(entry->type == MULTIBOOT_MEMORY_AVAILABLE && entry->addr < (u64int) totalFrames * FRAME_SIZE) {
 
-            for(u32int i = 0; i < numberOfFrames; i++) {
+            u32int start = ((u32int) entry->addr + FRAME_SIZE - 1) / FRAME_SIZE;
+            u32int end = (entry->addr + entry->len) / FRAME_SIZE;
 
-                void* frameAddr = (void*) (u32int) entry->addr + (i * FRAME_SIZE);
+            if(end > totalFrames)
+                end = totalFrames;
 
-                /* Frame 0(Starting at address 0) + Kernel + PMM stack is reserved */
-                if(frameAddr != NULL && (frameAddr < (void*) mbHead.loadAddr || frameAddr > (void*) kernelEnd + totalFrames * sizeof(void *)))
-                    StackPMM_freeFrame(frameAddr);
+            if(start == 0)
+                start = 1;
 
-            }
+            StackPMM_addRange(start, end < reservedStartIndex ? end : reservedStartIndex);
+            StackPMM_addRange(start > reservedEndIndex ? start : reservedEndIndex, end);
 
         }
 
@@ -98,7 +214,11 @@ PUBLIC PhysicalMemoryInfo* StackPMM_getInfo(PhysicalMemoryInfo* buf) {
 
     buf->totalMemory = totalPhysicalMemory;
     buf->totalFrames = totalFrames;
-    buf->freeFrames = stack.size;
+    buf->freeFrames = stack.size + rangeFrames;
+
+    /* Every free frame is handed out as a block of its own */
+    Memory_set(buf->freeBlocks, 0, sizeof(buf->freeBlocks));
+    buf->freeBlocks[0] = stack.size + rangeFrames;
 
     return buf;
 
@@ -0,0 +1,174 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| Swap.c
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Compressed in-memory store for pages evicted from user
+|               address spaces(see VirtualMemory_reclaim).
+|
+|               Every stored page is an LZ block on the kernel heap,
+|               prefixed with its length. Slots index a table of these
+|               blocks, the table grows when it is full.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#include <Memory/Swap.h>
+#include <Memory/HeapMemory.h>
+#include <Memory/PhysicalMemory.h>
+#include <Lib/LZ.h>
+#include <Memory.h>
+#include <Debug.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define SWAP_MAX_COMPRESSED (FRAME_SIZE - FRAME_SIZE / 8) /* Keep a page only if it saves at least 1/8 */
+#define SWAP_INITIAL_SLOTS  64
+
+/*=======================================================
+    STRUCT
+=========================================================*/
+typedef struct SwapBlock SwapBlock;
+
+struct SwapBlock {
+
+    u16int length; /* Compressed length */
+    u8int  data[];
+
+};
+
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE SwapBlock** slots;
+PRIVATE u32int      numberOfSlots;
+PRIVATE u32int      freeHint; /* No free slot below this one */
+
+PRIVATE u8int       buffer[SWAP_MAX_COMPRESSED];
+PRIVATE u8int       workspace[LZ_WORKSPACE_SIZE];
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/* Returns a free slot, growing the table if needed */
+PRIVATE u32int Swap_getFreeSlot(void) {
+
+    for(u32int i = freeHint; i < numberOfSlots; i++) {
+
+        if(slots[i] == NULL) {
+
+            freeHint = i + 1;
+            return i;
+
+        }
+
+    }
+
+    u32int newSize = numberOfSlots == 0 ? SWAP_INITIAL_SLOTS : numberOfSlots * 2;
+
+    if(newSize > SWAP_MAX_SLOTS)
+        newSize = SWAP_MAX_SLOTS;
+
+    if(newSize == numberOfSlots) /* Table is full */
+        return SWAP_NO_SLOT;
+
+    u32int owner = HeapMemory_setOwner(HEAP_OWNER_KERNEL); /* Shared by every process */
+    SwapBlock** newSlots = HeapMemory_realloc(slots, newSize * sizeof(SwapBlock*));
+    HeapMemory_setOwner(owner);
+
+    if(newSlots == NULL)
+        return SWAP_NO_SLOT;
+
+    Memory_set(newSlots + numberOfSlots, 0, (newSize - numberOfSlots) * sizeof(SwapBlock*));
+    slots = newSlots;
+
+    u32int slot = numberOfSlots;
+    numberOfSlots = newSize;
+    freeHint = slot + 1;
+
+    return slot;
+
+}
+
+PUBLIC u32int Swap_store(const void* page) {
+
+    Debug_assert(page != NULL);
+
+    u32int length = LZ_compress(page, FRAME_SIZE, buffer, sizeof(buffer), workspace);
+
+    if(length == 0) /* Incompressible */
+        return SWAP_NO_SLOT;
+
+    /* Pages are reclaimed from whichever process, not the running one. Freed with Swap_free when unmapped */
+    u32int owner = HeapMemory_setOwner(HEAP_OWNER_KERNEL);
+    SwapBlock* block = HeapMemory_alloc(sizeof(SwapBlock) + length);
+    HeapMemory_setOwner(owner);
+
+    if(block == NULL)
+        return SWAP_NO_SLOT;
+
+    u32int slot = Swap_getFreeSlot();
+
+    if(slot == SWAP_NO_SLOT) {
+
+        HeapMemory_free(block);
+        return SWAP_NO_SLOT;
+
+    }
+
+    block->length = length;
+    Memory_copy(block->data, buffer, length);
+    slots[slot] = block;
+
+    return slot;
+
+}
+
+PUBLIC void Swap_load(u32int slot, void* page) {
+
+    Debug_assert(slot < numberOfSlots && slots[slot] != NULL);
+
+    u32int length = LZ_decompress(slots[slot]->data, slots[slot]->length, page, FRAME_SIZE);
+    Debug_assert(length == FRAME_SIZE);
+    UNUSED(length);
+
+}
+
+PUBLIC u32int Swap_duplicate(u32int slot) {
+
+    Debug_assert(slot < numberOfSlots && slots[slot] != NULL);
+
+    u32int size = sizeof(SwapBlock) + slots[slot]->length;
+    u32int owner = HeapMemory_setOwner(HEAP_OWNER_KERNEL);
+    SwapBlock* block = HeapMemory_alloc(size);
+    HeapMemory_setOwner(owner);
+    Debug_assert(block != NULL);
+
+    u32int copy = Swap_getFreeSlot();
+    Debug_assert(copy != SWAP_NO_SLOT);
+
+    Memory_copy(block, slots[slot], size); /* Table may have moved, read it after growing */
+    slots[copy] = block;
+
+    return copy;
+
+}
+
+PUBLIC void Swap_free(u32int slot) {
+
+    Debug_assert(slot < numberOfSlots && slots[slot] != NULL);
+
+    HeapMemory_free(slots[slot]);
+    slots[slot] = NULL;
+
+    if(slot < freeHint)
+        freeHint = slot;
+
+}
@@ -0,0 +1,377 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| TLSF.c (implements HeapMemory)
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Two-Level Segregated Fit heap manager, malloc and free run
+|               in bounded time(no list walks, no loops over block sizes).
+|
+|               Free blocks are kept in lists by size. The first level
+|               splits sizes by powers of two, the second level splits
+|               each power of two into SL_INDEX_COUNT ranges. A bitmap per
+|               level tells which lists are not empty, so a fitting list
+|               is found with two bit scans.
+|
+|               Every block starts with a header holding its size and the
+|               block physically before it, so free neighbours are merged
+|               without searching. Regions taken from HeapMemory_expand
+|               end with an empty used block(sentinel).
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#include <Memory/TLSF.h>
+#include <Memory/HeapMemory.h>
+#include <Memory/PhysicalMemory.h>
+#include <Memory.h>
+#include <Debug.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define ALIGN_LOG2        3
+#define ALIGN_SIZE        (1 << ALIGN_LOG2)
+
+#define SL_INDEX_LOG2     4
+#define SL_INDEX_COUNT    (1 << SL_INDEX_LOG2)
+#define FL_INDEX_SHIFT    (SL_INDEX_LOG2 + ALIGN_LOG2)
+#define FL_INDEX_MAX      29 /* Blocks are smaller than 2^29, the size of the kernel heap window */
+#define FL_INDEX_COUNT    (FL_INDEX_MAX - FL_INDEX_SHIFT + 1)
+#define SMALL_BLOCK_SIZE  (1 << FL_INDEX_SHIFT) /* Smaller sizes share first level 0, split linearly */
+
+#define BLOCK_HEADER_SIZE (2 * sizeof(void*)) /* Payload starts after "prevPhys" and "size" */
+#define BLOCK_SIZE_MIN    (2 * sizeof(void*)) /* Free blocks keep their list links in the payload */
+#define BLOCK_SIZE_MAX    (1U << FL_INDEX_MAX)
+#define BLOCK_FREE        0x1 /* In "size", sizes are multiples of ALIGN_SIZE */
+
+#define TLSF_GROW_MIN     (16 * FRAME_SIZE) /* Heap grows by at least this much */
+
+#define TLSF_SIZE(block)  ((block)->size & ~BLOCK_FREE)
+#define TLSF_NEXT(block)  ((Block*) ((char*) (block) + BLOCK_HEADER_SIZE + TLSF_SIZE(block)))
+
+/*=======================================================
+    STRUCT
+=========================================================*/
+typedef struct Block Block;
+
+struct Block {
+
+    Block* prevPhys; /* Block before this one in memory, NULL if first in its region */
+    u32int size;     /* Payload size | BLOCK_FREE */
+
+    /* Free blocks only, used blocks have their payload here */
+    Block* nextFree;
+    Block* prevFree;
+
+};
+
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE u32int flBitmap;
+PRIVATE u32int slBitmap[FL_INDEX_COUNT];
+PRIVATE Block* freeLists[FL_INDEX_COUNT][SL_INDEX_COUNT];
+PRIVATE Block* sentinel; /* End of the region grown last */
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/* First and second level list of a block size */
+PRIVATE void TLSF_mapping(u32int size, u32int* fl, u32int* sl) {
+
+    if(size < SMALL_BLOCK_SIZE) {
+
+        *fl = 0;
+        *sl = size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT);
+
+    } else {
+
+        u32int bit = 31 - __builtin_clz(size);
+        *sl = (size >> (bit - SL_INDEX_LOG2)) ^ SL_INDEX_COUNT;
+        *fl = bit - FL_INDEX_SHIFT + 1;
+
+    }
+
+}
+
+PRIVATE void TLSF_insert(Block* block) {
+
+    u32int fl, sl;
+    TLSF_mapping(TLSF_SIZE(block), &fl, &sl);
+
+    Block* head = freeLists[fl][sl];
+    block->nextFree = head;
+    block->prevFree = NULL;
+
+    if(head != NULL)
+        head->prevFree = block;
+
+    freeLists[fl][sl] = block;
+    flBitmap |= 1 << fl;
+    slBitmap[fl] |= 1 << sl;
+
+}
+
+PRIVATE void TLSF_remove(Block* block) {
+
+    u32int fl, sl;
+    TLSF_mapping(TLSF_SIZE(block), &fl, &sl);
+
+    if(block->prevFree != NULL)
+        block->prevFree->nextFree = block->nextFree;
+    else
+        freeLists[fl][sl] = block->nextFree;
+
+    if(block->nextFree != NULL)
+        block->nextFree->prevFree = block->prevFree;
+
+    if(freeLists[fl][sl] == NULL) { /* List is empty now */
+
+        slBitmap[fl] &= ~(1 << sl);
+
+        if(slBitmap[fl] == 0)
+            flBitmap &= ~(1 << fl);
+
+    }
+
+}
+
+/* Rounds a size up to the next list boundary, every block in that list is large enough */
+PRIVATE u32int TLSF_roundUp(u32int size) {
+
+    if(size >= SMALL_BLOCK_SIZE)
+        size += (1 << (31 - __builtin_clz(size) - SL_INDEX_LOG2)) - 1;
+
+    return size;
+
+}
+
+/* Free block of at least "size" bytes, taken off its list. NULL if there is none */
+PRIVATE Block* TLSF_find(u32int size) {
+
+    u32int fl, sl;
+    TLSF_mapping(TLSF_roundUp(size), &fl, &sl);
+
+    if(fl >= FL_INDEX_COUNT)
+        return NULL;
+
+    u32int slMap = slBitmap[fl] & (~0U << sl);
+
+    if(slMap == 0) { /* Nothing in this first level, take the smallest larger one */
+
+        u32int flMap = fl + 1 < FL_INDEX_COUNT ? flBitmap & (~0U << (fl + 1)) : 0;
+
+        if(flMap == 0)
+            return NULL;
+
+        fl = __builtin_ctz(flMap);
+        slMap = slBitmap[fl];
+
+    }
+
+    Block* block = freeLists[fl][__builtin_ctz(slMap)];
+    TLSF_remove(block);
+
+    return block;
+
+}
+
+/* Merges a block with free neighbours and puts the result on its free list */
+PRIVATE void TLSF_release(Block* block) {
+
+    block->size |= BLOCK_FREE;
+
+    Block* prev = block->prevPhys;
+
+    if(prev != NULL && (prev->size & BLOCK_FREE)) {
+
+        TLSF_remove(prev);
+        prev->size += BLOCK_HEADER_SIZE + TLSF_SIZE(block);
+        block = prev;
+
+    }
+
+    Block* next = TLSF_NEXT(block);
+
+    if(next->size & BLOCK_FREE) {
+
+        TLSF_remove(next);
+        block->size += BLOCK_HEADER_SIZE + TLSF_SIZE(next);
+
+    }
+
+    TLSF_NEXT(block)->prevPhys = block;
+    TLSF_insert(block);
+
+}
+
+/* Shrinks a used block to "size", the rest becomes a free block if it is large enough */
+PRIVATE void TLSF_trim(Block* block, u32int size) {
+
+    u32int total = TLSF_SIZE(block);
+
+    if(total < size + BLOCK_HEADER_SIZE + BLOCK_SIZE_MIN)
+        return;
+
+    Block* rest = (Block*) ((char*) block + BLOCK_HEADER_SIZE + size);
+    rest->prevPhys = block;
+    rest->size = total - size - BLOCK_HEADER_SIZE;
+    block->size = size;
+
+    TLSF_release(rest);
+
+}
+
+/* Adds memory from HeapMemory_expand, enough for a block of "size" bytes */
+PRIVATE void TLSF_grow(u32int size) {
+
+    /* Room for the block header and the end sentinel, in whole pages. Rounded so that TLSF_find accepts the block */
+    u32int bytes = (TLSF_roundUp(size) + 2 * BLOCK_HEADER_SIZE + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+
+    if(bytes < TLSF_GROW_MIN)
+        bytes = TLSF_GROW_MIN;
+
+    char* region = HeapMemory_expand(bytes);
+    Block* block;
+
+    if(sentinel != NULL && region == (char*) sentinel + BLOCK_HEADER_SIZE) { /* Continues the last region, its sentinel becomes the new block */
+
+        block = sentinel;
+        block->size = bytes - BLOCK_HEADER_SIZE;
+
+    } else { /* Someone else grew the heap in between, start a new region */
+
+        block = (Block*) region;
+        block->prevPhys = NULL;
+        block->size = bytes - 2 * BLOCK_HEADER_SIZE;
+
+    }
+
+    sentinel = TLSF_NEXT(block);
+    sentinel->prevPhys = block;
+    sentinel->size = 0;
+
+    TLSF_release(block);
+
+}
+
+/* Block size for a request, 0 if it is too large */
+PRIVATE u32int TLSF_adjustSize(size_t bytes) {
+
+    if(bytes > BLOCK_SIZE_MAX / 2)
+        return 0;
+
+    u32int size = (bytes + ALIGN_SIZE - 1) & ~(ALIGN_SIZE - 1);
+
+    return size < BLOCK_SIZE_MIN ? BLOCK_SIZE_MIN : size;
+
+}
+
+PUBLIC void* TLSF_malloc(size_t bytes) {
+
+    u32int size = TLSF_adjustSize(bytes);
+
+    if(size == 0)
+        return NULL;
+
+    Block* block = TLSF_find(size);
+
+    if(block == NULL) { /* Out of free blocks, grow and retry */
+
+        TLSF_grow(size);
+        block = TLSF_find(size);
+
+        if(block == NULL)
+            return NULL;
+
+    }
+
+    block->size &= ~BLOCK_FREE;
+    TLSF_trim(block, size);
+
+    return (char*) block + BLOCK_HEADER_SIZE;
+
+}
+
+PUBLIC void* TLSF_realloc(void* oldmem, size_t bytes) {
+
+    if(oldmem == NULL)
+        return TLSF_malloc(bytes);
+
+    if(bytes == 0) {
+
+        TLSF_free(oldmem);
+        return NULL;
+
+    }
+
+    u32int size = TLSF_adjustSize(bytes);
+
+    if(size == 0)
+        return NULL;
+
+    Block* block = (Block*) ((char*) oldmem - BLOCK_HEADER_SIZE);
+    Block* next = TLSF_NEXT(block);
+    u32int current = TLSF_SIZE(block);
+
+    /* Grow in place by taking over a free block that follows */
+    if(size > current && (next->size & BLOCK_FREE) && current + BLOCK_HEADER_SIZE + TLSF_SIZE(next) >= size) {
+
+        TLSF_remove(next);
+        block->size += BLOCK_HEADER_SIZE + TLSF_SIZE(next);
+        TLSF_NEXT(block)->prevPhys = block;
+        current = TLSF_SIZE(block);
+
+    }
+
+    if(size <= current) {
+
+        TLSF_trim(block, size);
+        return oldmem;
+
+    }
+
+    void* mem = TLSF_malloc(bytes);
+
+    if(mem != NULL) {
+
+        Memory_copy(mem, oldmem, current);
+        TLSF_free(oldmem);
+
+    }
+
+    return mem;
+
+}
+
+PUBLIC void* TLSF_calloc(size_t numberOfElements, size_t elementSize) {
+
+    if(elementSize != 0 && numberOfElements > 0xFFFFFFFF / elementSize) /* Overflow */
+        return NULL;
+
+    void* mem = TLSF_malloc(numberOfElements * elementSize);
+
+    if(mem != NULL)
+        Memory_set(mem, 0, numberOfElements * elementSize);
+
+    return mem;
+
+}
+
+PUBLIC void TLSF_free(void* mem) {
+
+    if(mem == NULL)
+        return;
+
+    Block* block = (Block*) ((char*) mem - BLOCK_HEADER_SIZE);
+    Debug_assert(!(block->size & BLOCK_FREE)); /* Double free */
+
+    TLSF_release(block);
+
+}
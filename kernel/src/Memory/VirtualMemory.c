@@ -15,6 +15,8 @@
 
 #include <Memory/VirtualMemory.h>
 #include <Memory/PhysicalMemory.h>
+#include <Memory/HeapMemory.h>
+#include <Memory/Swap.h>
 #include <X86/CPU.h>
 #include <X86/IDT.h>
 #include <Debug.h>
@@ -31,7 +33,31 @@
 #define ADDR_TO_FRAME_INDEX(addr) ((u32int) addr / FRAME_SIZE)
 #define FRAME_INDEX_TO_ADDR(index) ((void*) (index * FRAME_SIZE))
 
-#define KERNEL_HEAP_MAP_SIZE_MB  32
+/* Keep page 0 unmapped to catch NULL accesses, unless the first 4MB are asked to be a single 4MB page */
+#ifdef VMM_LARGE_IDENTITY
+#define NULL_GUARD FALSE
+#else
+#define NULL_GUARD TRUE
+#endif
+
+/* Bottom 4MB, direct map and kernel heap, mapped the same in every address space */
+#define IS_KERNEL_PAGE(x) (PDE_INDEX(x) == 0 || IS_DIRECT_MAPPED(x) || ((u32int) x >= KERNEL_HEAP_BASE_VADDR && (u32int) x < KERNEL_HEAP_TOP_VADDR))
+#define IS_DIRECT_MAPPED(x) ((u32int) x >= DIRECT_MAP_VADDR && (u32int) x < DIRECT_MAP_VADDR + DIRECT_MAP_SIZE)
+
+/* Page reclaim, see VirtualMemory_reclaim */
+#define RECLAIM_LOW_FRAMES  64 /* Reclaim before allocating for a process when fewer frames are free */
+#define RECLAIM_BATCH       16 /* Frames to reclaim at a time */
+#define RECLAIM_RESERVE     8  /* Only drop clean pages when fewer frames are free, storing needs heap memory */
+#define RECLAIM_DIR_VADDR   ((void*) RECLAIM_MAP_VADDR)
+#define RECLAIM_TABLE_VADDR ((void*) (RECLAIM_MAP_VADDR + FRAME_SIZE))
+#define RECLAIM_PAGE_VADDR  ((void*) (RECLAIM_MAP_VADDR + 2 * FRAME_SIZE))
+
+/* Frames freed with one call to the physical memory manager when tearing down an address space */
+#define FREE_BATCH 64
+
+/* Page fault error code bits */
+#define PF_PRESENT 0x1 /* 0: page not present, 1: protection violation */
+#define PF_WRITE   0x2 /* 0: read access, 1: write access */
 
 /*=======================================================
     STRUCT
@@ -39,6 +65,7 @@
 typedef struct PageTableEntry     PageTableEntry;
 typedef struct PageTable          PageTable;
 typedef struct PageDirectoryEntry PageDirectoryEntry;
+typedef struct MemoryMapping      MemoryMapping;
 
 /* 4-Byte Page Table Entry */
 struct PageTableEntry {
@@ -76,11 +103,32 @@ struct PageTableEntry {
     */
     u8int  isDirty      :  1;
 
-    /* Reserved */
-    u16int              :  2;
+    /* Page attribute table index, not used */
+    u8int               :  1;
 
-    /* Available for use */
-    u8int               :  3;
+    /* Global page(needs CR4.PGE), kept in the TLB when CR3 is loaded
+        0: Not global
+        1: Global
+    */
+    u8int  isGlobal     :  1;
+
+    /* Is the frame shared(e.g. mapped from the ramdisk, the zero page)?
+        0: Frame belongs to this page
+        1: Frame is not owned, mapped read only, never freed and copied on write
+    */
+    u8int  isShared     :  1;
+
+    /* Is the frame shared with other address spaces(fork)?
+        0: No
+        1: Yes, mapped read only, reference counted and copied on write
+    */
+    u8int  isCopyOnWrite :  1;
+
+    /* Is the page compressed in the swap store(only when not in memory)?
+        0: No
+        1: Yes, frameIndex is the swap slot
+    */
+    u8int  isSwapped    :  1;
 
     /* Frame address */
     u32int frameIndex   : 20;
@@ -142,6 +190,10 @@ struct PageDirectoryEntry {
     */
     u8int  pageSize         :  1;
 
+    /* Global flag, only used by 4MB pages and the recursive page table mapping
+        0: Not global
+        1: Global
+    */
     u8int  globalPage       :  1;
 
     /* Available for use */
@@ -159,11 +211,30 @@ struct PageDirectory {
 
 };
 
+/* Region of user memory made with VirtualMemory_mmap, pages are mapped on first touch */
+struct MemoryMapping {
+
+    u32int   start;  /* Page aligned virtual address */
+    u32int   pages;  /* Size in pages */
+    VFSNode* file;   /* Backing file(read only), NULL if anonymous */
+    u32int   offset; /* Offset into "file" of the first page */
+
+};
+
 /*=======================================================
     PRIVATE DATA
 =========================================================*/
 PRIVATE Module vmmModule;
 PRIVATE PageDirectory* kernelDir;
+PRIVATE bool largePages; /* CR4.PSE enabled */
+PRIVATE u32int directMapSize; /* Physical memory reachable through the direct map, 0 until paging is enabled */
+PRIVATE u32int kernelHeapLimit; /* End of the kernel heap window covered by boot time page tables */
+PRIVATE void* zeroFrame; /* Read only backing of untouched zero initialised user pages, never freed */
+
+/* Clock hand of the page reclaimer, a process index and a virtual address in it */
+PRIVATE u32int clockProcess;
+PRIVATE u32int clockPage = USER_CODE_BASE_VADDR;
+PRIVATE bool   reclaiming;
 
 /*=======================================================
     FUNCTION
@@ -195,343 +266,1294 @@ PRIVATE void VirtualMemory_setPaging(bool state) {
 
 }
 
-PRIVATE void VirtualMemory_pageFaultHandler(Regs* regs) {
+/* Page table entry of a virtual address in the current page directory, page table must be present */
+PRIVATE PageTableEntry* VirtualMemory_getPTE(void* virtualAddr) {
 
-    Process* process = Scheduler_getCurrentProcess();
-    Debug_assert(process != NULL);
+    PageTable* pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
+    return &pageTable->entries[PTE_INDEX(virtualAddr)];
 
-    u32int faultAddr;
-    asm volatile("mov %%CR2, %0" : "=a" (faultAddr)); /* Retrieve the address that raised the page fault */
+}
 
-    Console_setColor(CONSOLE_ERROR);
-    Console_printf("%s", "Process page fault!\n");
-    Console_printf("%s%d%c", "pid: ", process->pid, '\n');
-    Console_printf("%s%d%c%d%c", "cs-eip: ", regs->cs, ':' ,regs->eip, '\n');
-    Console_printf("%s%d%c", "address: ", faultAddr, '\n');
+/* Checks whether a page directory is the one loaded in CR3 */
+PRIVATE bool VirtualMemory_isCurrentDir(void* dir) {
 
-    if(process->pid == KERNEL_PID) { /* Panic if it is the kernel process */
+    u32int cr3 = CPU_getCR(3);
+    CR3 reg = FORCE_CAST(cr3, CR3);
 
-        Sys_panic("Page fault!");
+    return reg.PDBR == (u32int) dir / FRAME_SIZE;
 
-    } else { /* User process, kill it */
+}
 
-        ProcessManager_killProcess(-1);
+/* Allocates a frame for a user page, cold pages are reclaimed first when memory runs low */
+PRIVATE void* VirtualMemory_allocateUserFrame(bool zeroed) {
 
-    }
+    PhysicalMemoryInfo info;
+
+    if(PhysicalMemory_getInfo(&info)->freeFrames < RECLAIM_LOW_FRAMES)
+        VirtualMemory_reclaim(RECLAIM_BATCH, TRUE);
 
+    return zeroed ? PhysicalMemory_allocateZeroedFrame() : PhysicalMemory_allocateFrame();
 
 }
 
-PRIVATE void VirtualMemory_setPDE(PageDirectoryEntry* pde, PageTable* pageTable, bool mode) {
+/* Brings a compressed page back into memory */
+PRIVATE bool VirtualMemory_swapIn(PageTableEntry* pte, u32int page) {
 
-    Debug_assert(pde != NULL && pageTable != NULL);
+    void* frame = VirtualMemory_allocateUserFrame(FALSE);
 
-    Memory_set(pde, 0, sizeof(PageDirectoryEntry));
-    pde->frameIndex = ADDR_TO_FRAME_INDEX(pageTable);
-    pde->inMemory = TRUE;
-    pde->rwFlag = TRUE;
-    pde->mode = mode;
+    if(frame == NULL) /* Out of physical memory */
+        return FALSE;
+
+    void* data = VirtualMemory_mapFrame(frame, (void*) COPY_ON_WRITE_VADDR);
+    Swap_load(pte->frameIndex, data);
+    Swap_free(pte->frameIndex);
+    VirtualMemory_unmapFrame(data);
+
+    pte->frameIndex = ADDR_TO_FRAME_INDEX(frame);
+    pte->isSwapped = FALSE;
+    pte->isDirty = TRUE; /* Only copy of the data, must not be dropped as clean */
+    pte->inMemory = TRUE;
+    VirtualMemory_invalidateTLBEntry((void*) page);
+
+    return TRUE;
 
 }
 
-PRIVATE void VirtualMemory_setPTE(PageTableEntry* pte, void* physicalAddr, bool mode) {
+/* Returns the mapping of a process containing "addr", NULL if there is none */
+PRIVATE MemoryMapping* VirtualMemory_findMapping(Process* process, u32int addr) {
 
-    Debug_assert(pte != NULL && (u32int) physicalAddr % FRAME_SIZE == 0);
+    for(u32int i = 0; process->mappings != NULL && i < ArrayList_getSize(process->mappings); i++) {
 
-    Memory_set(pte, 0, sizeof(PageTableEntry));
-    pte->frameIndex = ADDR_TO_FRAME_INDEX(physicalAddr);
-    pte->inMemory = TRUE;
-    pte->rwFlag = TRUE;
-    pte->mode = mode;
+        MemoryMapping* mapping = ArrayList_get(process->mappings, i);
 
-}
+        if(addr >= mapping->start && addr < mapping->start + mapping->pages * FRAME_SIZE)
+            return mapping;
 
-PRIVATE void VirtualMemory_init(void) {
+    }
 
-    Debug_logInfo("%s%s", "Initialising ", vmmModule.moduleName);
+    return NULL;
 
-    /* Create the initial page directory */
-    PageDirectory* dir = PhysicalMemory_allocateFrame();
-    Memory_set(dir, 0, sizeof(PageDirectory));
-    VirtualMemory_switchPageDir(dir);
-    kernelDir = dir;
+}
 
-    /* Identity map first 4MB (except first 4096kb in order to catch NULLs) */
-    PageTable* first4MB = PhysicalMemory_allocateFrame();
+/* Checks whether [start, end) lies between the code image and user heap without overlapping another mapping */
+PRIVATE bool VirtualMemory_isRangeFree(Process* process, u32int start, u32int end) {
 
-    for(int i = 1; i < 1024; i++) {
+    if(start < USER_CODE_BASE_VADDR + process->codePages * FRAME_SIZE || end > USER_MMAP_TOP_VADDR || end <= start)
+        return FALSE;
 
-        PageTableEntry* pte = &first4MB->entries[i];
-        VirtualMemory_setPTE(pte, FRAME_INDEX_TO_ADDR(i), MODE_KERNEL);
+    for(u32int i = 0; process->mappings != NULL && i < ArrayList_getSize(process->mappings); i++) {
+
+        MemoryMapping* mapping = ArrayList_get(process->mappings, i);
+
+        if(start < mapping->start + mapping->pages * FRAME_SIZE && end > mapping->start)
+            return FALSE;
 
     }
 
-    VirtualMemory_setPDE(&dir->entries[0], first4MB, MODE_KERNEL);
-    /* End of identity map */
+    return TRUE;
 
-    /* Map directory to last virtual 4MB - recursive mapping, lets us manipulate the page directory after paging is enabled */
-    dir->entries[1023].frameIndex = ADDR_TO_FRAME_INDEX(dir);
-    dir->entries[1023].inMemory = TRUE;
-    dir->entries[1023].rwFlag = TRUE;
-    dir->entries[1023].mode = MODE_KERNEL;
+}
 
-    /* Register page fault handler */
-    IDT_registerHandler(&VirtualMemory_pageFaultHandler, 14);
+/* Unmaps pages of the current address space, frames owned by the process are freed, file system frames are kept */
+PRIVATE void VirtualMemory_freeUserPages(u32int start, u32int pages) {
 
-    /* Turn on paging */
-    VirtualMemory_setPaging(TRUE);
+    PageDirectory* dir = (PageDirectory*) 0xFFFFF000;
 
-}
+    for(u32int page = start; page < start + pages * FRAME_SIZE; page += FRAME_SIZE) {
 
-PUBLIC void* VirtualMemory_quickMap(void* virtualAddr, void* physicalAddr) {
+        if(!dir->entries[PDE_INDEX(page)].inMemory)
+            continue;
 
-    /* Map to current page dir */
+        PageTableEntry* pte = VirtualMemory_getPTE((void*) page);
 
-    /* Addresses should be page aligned */
-    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0 && (u32int) physicalAddr % FRAME_SIZE == 0);
+        if(pte->isSwapped) { /* Only the compressed copy exists */
 
-    PageDirectory* dir = (PageDirectory*) 0xFFFFF000; /* Get current page directory */
-    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+            Swap_free(pte->frameIndex);
+            Memory_set(pte, 0, sizeof(PageTableEntry));
+            continue;
 
-    if(!pde->inMemory) { /* Need to allocate a page table */
+        }
 
-        PageTable* pageTable = PhysicalMemory_allocateFrame();
+        if(!pte->inMemory)
+            continue;
 
-        Debug_assert(pageTable != NULL); /* Out of physical memory */
+        void* phys = FRAME_INDEX_TO_ADDR(pte->frameIndex);
 
-        VirtualMemory_setPDE(pde, pageTable, MODE_KERNEL);
-        pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
-        Memory_set(pageTable, 0, sizeof(PageTable));
+        if(!pte->isShared && PhysicalMemory_dropFrameReference(phys)) /* Not used by a forked process */
+            PhysicalMemory_freeFrame(phys);
+
+        Memory_set(pte, 0, sizeof(PageTableEntry));
+        VirtualMemory_invalidateTLBEntry((void*) page);
 
     }
 
-    PageTable* pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
-    PageTableEntry* pte = &pageTable->entries[PTE_INDEX(virtualAddr)];
-    VirtualMemory_setPTE(pte, physicalAddr, MODE_KERNEL);
-    VirtualMemory_invalidateTLBEntry(virtualAddr);
+}
 
-    return virtualAddr;
+/* Frees the mapping list of a process, pages are freed along with the page tables */
+PRIVATE void VirtualMemory_freeMappings(Process* process) {
+
+    if(process->mappings == NULL)
+        return;
+
+    for(u32int i = 0; i < ArrayList_getSize(process->mappings); i++)
+        HeapMemory_free(ArrayList_get(process->mappings, i));
+
+    ArrayList_destroy(process->mappings);
+    process->mappings = NULL;
 
 }
 
-PUBLIC void VirtualMemory_quickUnmap(void* virtualAddr) {
+/* Gives the process a private copy of a shared read only page it wrote to */
+PRIVATE bool VirtualMemory_copyOnWrite(Process* process, u32int page) {
 
-    /* Unmap from current page dir */
+    PageTableEntry* pte = VirtualMemory_getPTE((void*) page);
 
-    /* Address should be page aligned */
-    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0);
+    if(!pte->isShared && !pte->isCopyOnWrite)
+        return FALSE;
 
-    PageDirectory* dir = (PageDirectory*) 0xFFFFF000; /* Get current page directory */
-    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+    void* oldFrame = FRAME_INDEX_TO_ADDR(pte->frameIndex);
 
-    Debug_assert(pde->inMemory);
+    if(pte->isCopyOnWrite && !PhysicalMemory_isFrameShared(oldFrame)) { /* Every other sharer is gone, take it over */
 
-    PageTable* pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
-    PageTableEntry* pte = &pageTable->entries[PTE_INDEX(virtualAddr)];
+        pte->isCopyOnWrite = FALSE;
+        pte->rwFlag = TRUE;
+        VirtualMemory_invalidateTLBEntry((void*) page);
+        return TRUE;
 
-    Debug_assert(pte->inMemory);
+    }
 
-    Memory_set(pte, 0, sizeof(PageTableEntry));
-    VirtualMemory_invalidateTLBEntry(virtualAddr);
+    bool isZero = oldFrame == zeroFrame; /* A zeroed frame is all the copy it needs */
+    void* frame = VirtualMemory_allocateUserFrame(isZero);
 
-}
+    if(frame == NULL) /* Out of physical memory */
+        return FALSE;
 
-PUBLIC PageDirectory* VirtualMemory_getKernelDir(void) {
+    if(!isZero) {
 
-    return kernelDir;
+        void* copy = VirtualMemory_mapFrame(frame, (void*) COPY_ON_WRITE_VADDR);
+        Memory_copy(copy, (void*) page, FRAME_SIZE);
+        VirtualMemory_unmapFrame(copy);
 
-}
+    }
 
-PUBLIC void VirtualMemory_switchPageDir(PageDirectory* dir) {
+    if(pte->isCopyOnWrite)
+        PhysicalMemory_dropFrameReference(oldFrame); /* Can't be the last one, checked above */
 
-    Debug_assert(dir != NULL);
+    pte->frameIndex = ADDR_TO_FRAME_INDEX(frame);
+    pte->isShared = FALSE;
+    pte->isCopyOnWrite = FALSE;
+    pte->rwFlag = TRUE;
+    VirtualMemory_invalidateTLBEntry((void*) page);
+    process->privateFaults++;
 
-    /* Set page directory base register */
-    u32int cr3 = CPU_getCR(3);
-    CR3 reg = FORCE_CAST(cr3, CR3);
-    reg.PDBR = (u32int) &dir->entries / FRAME_SIZE;
-    CPU_setCR(3, FORCE_CAST(reg, u32int));
+    return TRUE;
 
-    /* Flush all TLB entries */
-    VirtualMemory_invalidateTLB();
 }
 
-PUBLIC void VirtualMemory_mapKernel(Process* process) {
+/* Maps the zero frame read only, the first write gets a private zeroed frame(see VirtualMemory_copyOnWrite) */
+PRIVATE void VirtualMemory_mapZeroPage(Process* process, u32int page) {
 
-    Debug_assert(process != NULL);
+    VirtualMemory_mapPage(process->pageDir, (void*) page, zeroFrame, MODE_USER);
 
-    PageDirectory* pageDir = VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR, process->pageDir); /* Map it so that we can access it */
-    PageDirectory* kDir = VirtualMemory_quickMap((void*) (TEMPORARY_MAP_VADDR + 0x1000), kernelDir); /* Map it so that we can access it */
+    PageTableEntry* pte = VirtualMemory_getPTE((void*) page);
+    pte->rwFlag = FALSE;
+    pte->isShared = TRUE;
+    VirtualMemory_invalidateTLBEntry((void*) page);
+    process->zeroFaults++;
 
-    /* Map bottom 4MB */
-    PageDirectoryEntry* pde = &pageDir->entries[0];
-    Memory_set(pde, 0, sizeof(PageDirectoryEntry));
-    pde->frameIndex = kDir->entries[0].frameIndex;
-    pde->inMemory = TRUE;
-    pde->rwFlag = TRUE;
-    pde->mode = MODE_KERNEL;
+}
 
-    /* Map kernel heap, starting from  (KERNEL_HEAP_BASE_VADDR) to (KERNEL_HEAP_BASE_VADDR + KERNEL_HEAP_MAP_SIZE_MB) */
-    for(u32int i = PDE_INDEX(KERNEL_HEAP_BASE_VADDR); i < PDE_INDEX(KERNEL_HEAP_BASE_VADDR) + KERNEL_HEAP_MAP_SIZE_MB / 4; i++) {
+/* Backs a page the process is allowed to touch but has not been mapped yet, returns FALSE if the access is invalid */
+PRIVATE bool VirtualMemory_demandPage(Process* process, u32int faultAddr, u32int errCode) {
 
-        pde = &pageDir->entries[i];
-        Memory_set(pde, 0, sizeof(PageDirectoryEntry));
+    if(process->pid == KERNEL_PID)
+        return FALSE;
 
-        if(kDir->entries[i].inMemory) {
+    u32int page = faultAddr & ~(FRAME_SIZE - 1);
+    u32int codeEnd = USER_CODE_BASE_VADDR + process->codePages * FRAME_SIZE;
+    bool isCode = faultAddr >= USER_CODE_BASE_VADDR && faultAddr < codeEnd;
+    bool isStack = faultAddr >= USER_STACK_GUARD_VADDR + FRAME_SIZE && faultAddr < USER_STACK_TOP_VADDR;
+    MemoryMapping* mapping = isCode ? NULL : VirtualMemory_findMapping(process, faultAddr);
 
-            pde->frameIndex = kDir->entries[i].frameIndex;
-            pde->inMemory = TRUE;
-            pde->rwFlag = TRUE;
-            pde->mode = MODE_KERNEL;
+    if(errCode & PF_PRESENT) { /* Only writes to shared or copy-on-write pages are allowed to fault on a present page */
 
-        }
+        if(mapping != NULL && mapping->file != NULL) /* File mappings are read only */
+            return FALSE;
+
+        return (errCode & PF_WRITE) && VirtualMemory_copyOnWrite(process, page);
 
     }
 
-    /* Unmap temporary mappings */
-    VirtualMemory_quickUnmap((void*) TEMPORARY_MAP_VADDR);
-    VirtualMemory_quickUnmap((void*) (TEMPORARY_MAP_VADDR + 0x1000));
+    PageDirectory* dir = (PageDirectory*) 0xFFFFF000;
 
-}
+    if(dir->entries[PDE_INDEX(page)].inMemory && VirtualMemory_getPTE((void*) page)->isSwapped) /* Evicted by the reclaimer */
+        return VirtualMemory_swapIn(VirtualMemory_getPTE((void*) page), page);
 
-PUBLIC void VirtualMemory_createPageDirectory(Process* process) {
+    /* Code is read from the executable image, user heap is reserved by sbrk, mappings by mmap, all are mapped on first touch */
+    if(!isCode && !isStack && mapping == NULL && (faultAddr < USER_HEAP_BASE_VADDR || faultAddr >= (u32int) process->userHeapTop))
+        return FALSE;
 
-    Debug_assert(process->pageDir == NULL);
+    if(isStack && page < (u32int) process->userStackBase) /* Stack grew, only touched pages are mapped */
+        process->userStackBase = (void*) page;
 
-    PageDirectory* dir = (PageDirectory*) PhysicalMemory_allocateFrame();
-    process->pageDir = dir;
-    dir = VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR, dir); /* Map it so that we can access it */
-    Memory_set(dir, 0, sizeof(PageDirectory));
+    /* Code and file mappings are backed by a file */
+    VFSNode* file = isCode ? process->image : (mapping != NULL ? mapping->file : NULL);
+    u32int offset = isCode ? page - USER_CODE_BASE_VADDR : (mapping != NULL ? mapping->offset + page - mapping->start : 0);
 
-    /* Map directory to last virtual 4MB - recursive mapping, lets us manipulate the page directory after paging is enabled */
-    dir->entries[1023].frameIndex = (ADDR_TO_FRAME_INDEX(process->pageDir));
-    dir->entries[1023].inMemory = TRUE;
-    dir->entries[1023].rwFlag = TRUE;
-    dir->entries[1023].mode = MODE_KERNEL;
+    if(file != NULL) { /* Map whole pages of a page aligned file straight from the file system, no copy */
 
-    /* Set all other entries as kernel mode as default */
-    for(int i = 0; i < 1023; i++)
-        dir->entries[i].mode = MODE_KERNEL;
+        void* fileFrame = NULL;
 
-    VirtualMemory_quickUnmap((void*) TEMPORARY_MAP_VADDR);
+        if(offset + FRAME_SIZE <= file->fileSize)
+            fileFrame = VFS_getImageFrame(file, offset);
 
-}
+        if(fileFrame != NULL) {
 
-PUBLIC void VirtualMemory_destroyPageDirectory(Process* process) {
+            VirtualMemory_mapPage(process->pageDir, (void*) page, fileFrame, MODE_USER);
 
-    Debug_assert(process->pageDir != NULL);
+            PageTableEntry* pte = VirtualMemory_getPTE((void*) page);
+            pte->rwFlag = FALSE;
+            pte->isShared = TRUE;
+            VirtualMemory_invalidateTLBEntry((void*) page);
 
-    /* Free every page table starting at 1GB(everything except kernel which is bottom 4MB + kernel heap) */
-    for(int i = PDE_INDEX(USER_CODE_BASE_VADDR); i < 1023; i++) {
+            return TRUE;
 
-        /* Map page directory so that we can access it */
-        PageDirectory* dir = VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR, process->pageDir);
-        PageDirectoryEntry* pde = &dir->entries[i];
+        }
+
+    }
 
-        if(pde->inMemory) {
+    /* Reading memory that is still all zeroes(heap, anonymous mapping, bss past the end of the image) costs no frame */
+    if(!(errCode & PF_WRITE) && !isStack && (file == NULL || offset >= file->fileSize)) {
 
-            PageTable* pageTable = (PageTable*) FRAME_INDEX_TO_ADDR(pde->frameIndex);
-            void* pageTablePhys = pageTable;
-            Debug_assert(pageTable != NULL);
-            pageTable = VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR, pageTable); /* Map page table so that we can access it */
+        VirtualMemory_mapZeroPage(process, page);
+        return TRUE;
 
-            /* Free all page table entries*/
-            for(int y = 0; y < 1024; y++) {
+    }
 
-                PageTableEntry* pte = &pageTable->entries[y];
+    void* frame = VirtualMemory_allocateUserFrame(TRUE);
 
-                if(pte->inMemory) {
+    if(frame == NULL) /* Out of physical memory */
+        return FALSE;
 
-                    void* phys = FRAME_INDEX_TO_ADDR(pte->frameIndex);
-                    Debug_assert(phys != NULL);
-                    PhysicalMemory_freeFrame(phys);
+    VirtualMemory_mapPage(process->pageDir, (void*) page, frame, MODE_USER);
+    process->privateFaults++;
 
-                }
+    if(file != NULL) { /* Fill from file, the part past the end of file stays zeroed(bss) */
 
-            }
+        if(offset < file->fileSize) {
 
-            PhysicalMemory_freeFrame(pageTablePhys);
+            u32int count = file->fileSize - offset;
+            VFS_readImage(file, offset, count < FRAME_SIZE ? count : FRAME_SIZE, (char*) page);
 
         }
 
+        /* Clean as far as the reclaimer is concerned, it can be read from the file again */
+        PageTableEntry* pte = VirtualMemory_getPTE((void*) page);
+        pte->isDirty = FALSE;
+
+        if(!isCode) /* Private copy of a file mapping, still read only */
+            pte->rwFlag = FALSE;
+
+        VirtualMemory_invalidateTLBEntry((void*) page);
+
     }
 
-    VirtualMemory_quickUnmap((void*) TEMPORARY_MAP_VADDR);
-    PhysicalMemory_freeFrame(process->pageDir);
+    return TRUE;
 
 }
 
-PUBLIC void* VirtualMemory_mapPage(PageDirectory* dir, void* virtualAddr, void* physicalAddr, bool mode) {
+PRIVATE void VirtualMemory_pageFaultHandler(Regs* regs) {
 
-    /* Addresses should be page aligned */
-    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0 && (u32int) physicalAddr % FRAME_SIZE == 0);
-    Debug_assert(dir != NULL);
+    Process* process = Scheduler_getCurrentProcess();
+    Debug_assert(process != NULL);
 
-    dir = VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR, dir);
-    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+    u32int faultAddr;
+    asm volatile("mov %%CR2, %0" : "=a" (faultAddr)); /* Retrieve the address that raised the page fault */
 
-    if(!pde->inMemory) { /* Need to allocate a page table */
+    if(VirtualMemory_demandPage(process, faultAddr, regs->errCode))
+        return;
 
-        PageTable* pageTable = PhysicalMemory_allocateFrame();
+    Console_setColor(CONSOLE_ERROR);
 
-        Debug_assert(pageTable != NULL); /* Out of physical memory */
+    if(faultAddr >= USER_STACK_GUARD_VADDR && faultAddr < USER_STACK_GUARD_VADDR + FRAME_SIZE)
+        Console_printf("%s", "Stack overflow!\n");
 
-        VirtualMemory_setPDE(pde, pageTable, mode);
-        pageTable = VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR + 0x1000, pageTable);
-        Memory_set(pageTable, 0, sizeof(PageTable));
+    Console_printf("%s", "Process page fault!\n");
+    Console_printf("%s%d%c", "pid: ", process->pid, '\n');
+    Console_printf("%s%d%c%d%c", "cs-eip: ", regs->cs, ':' ,regs->eip, '\n');
+    Console_printf("%s%d%c", "address: ", faultAddr, '\n');
+
+    if(process->pid == KERNEL_PID) { /* Panic if it is the kernel process */
+
+        Sys_panic("Page fault!");
+
+    } else { /* User process, kill it */
+
+        ProcessManager_killProcess(-1);
 
     }
 
-    PageTable* pageTable = VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR + 0x1000, FRAME_INDEX_TO_ADDR(pde->frameIndex));
-    PageTableEntry* pte = &pageTable->entries[PTE_INDEX(virtualAddr)];
-    VirtualMemory_setPTE(pte, physicalAddr, mode);
-    VirtualMemory_invalidateTLBEntry(virtualAddr);
 
-    VirtualMemory_quickUnmap((void*) TEMPORARY_MAP_VADDR);
-    VirtualMemory_quickUnmap((void*) TEMPORARY_MAP_VADDR + 0x1000);
+}
 
-    return virtualAddr;
+PRIVATE void VirtualMemory_setPDE(PageDirectoryEntry* pde, PageTable* pageTable, bool mode) {
+
+    Debug_assert(pde != NULL && pageTable != NULL);
+
+    Memory_set(pde, 0, sizeof(PageDirectoryEntry));
+    pde->frameIndex = ADDR_TO_FRAME_INDEX(pageTable);
+    pde->inMemory = TRUE;
+    pde->rwFlag = TRUE;
+    pde->mode = mode;
 
 }
 
-PUBLIC void VirtualMemory_unmapPage(PageDirectory* dir, void* virtualAddr) {
+PRIVATE void VirtualMemory_setLargePDE(PageDirectoryEntry* pde, void* physicalAddr, bool mode) {
 
-    /* Address should be page aligned */
-    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0);
-    Debug_assert(dir != NULL);
+    Debug_assert(pde != NULL && (u32int) physicalAddr % LARGE_PAGE_SIZE == 0);
 
-    dir = VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR, dir);
-    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+    Memory_set(pde, 0, sizeof(PageDirectoryEntry));
+    pde->frameIndex = ADDR_TO_FRAME_INDEX(physicalAddr);
+    pde->inMemory = TRUE;
+    pde->rwFlag = TRUE;
+    pde->mode = mode;
+    pde->pageSize = TRUE;
 
-    Debug_assert(pde->inMemory);
+}
 
-    PageTable* pageTable = VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR, FRAME_INDEX_TO_ADDR(pde->frameIndex));
-    PageTableEntry* pte = &pageTable->entries[PTE_INDEX(virtualAddr)];
+PRIVATE void VirtualMemory_setPTE(PageTableEntry* pte, void* physicalAddr, bool mode) {
 
-    Debug_assert(pte->inMemory);
+    Debug_assert(pte != NULL && (u32int) physicalAddr % FRAME_SIZE == 0);
 
     Memory_set(pte, 0, sizeof(PageTableEntry));
-    VirtualMemory_invalidateTLBEntry(virtualAddr);
-    VirtualMemory_quickUnmap((void*) TEMPORARY_MAP_VADDR);
+    pte->frameIndex = ADDR_TO_FRAME_INDEX(physicalAddr);
+    pte->inMemory = TRUE;
+    pte->rwFlag = TRUE;
+    pte->mode = mode;
 
 }
 
-PUBLIC void* VirtualMemory_getPhysicalAddress(void* virtualAddr) {
+/* Clock step over one page, returns TRUE if its frame was freed */
+PRIVATE bool VirtualMemory_reclaimPage(PageTableEntry* pte, u32int page, bool isCurrent, bool compress) {
 
-    /* Address should be page aligned */
-    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0);
+    /* Shared frames are mapped elsewhere too, the top stack page may hold a context that was never switched to */
+    if(!pte->inMemory || pte->isShared || page == USER_STACK_BASE_VADDR)
+        return FALSE;
 
-    PageDirectory* dir = (PageDirectory*) 0xFFFFF000;
-    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+    void* frame = FRAME_INDEX_TO_ADDR(pte->frameIndex);
 
-    Debug_assert(pde->inMemory);
+    if(PhysicalMemory_isFrameShared(frame))
+        return FALSE;
 
-    PageTable* pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
-    PageTableEntry* pte = &pageTable->entries[PTE_INDEX(virtualAddr)];
+    if(pte->isAccessed) { /* Used since the last pass, second chance */
 
-    Debug_assert(pte->inMemory);
+        pte->isAccessed = FALSE;
+
+        if(isCurrent)
+            VirtualMemory_invalidateTLBEntry((void*) page);
+
+        return FALSE;
+
+    }
+
+    if(pte->isDirty) { /* Only a compressed copy can bring it back */
+
+        PhysicalMemoryInfo info;
+
+        if(!compress || PhysicalMemory_getInfo(&info)->freeFrames < RECLAIM_RESERVE)
+            return FALSE;
+
+        void* data = VirtualMemory_mapFrame(frame, RECLAIM_PAGE_VADDR);
+        u32int slot = Swap_store(data);
+        VirtualMemory_unmapFrame(data);
+
+        if(slot == SWAP_NO_SLOT) /* Does not compress, keep it */
+            return FALSE;
+
+        if(pte->isCopyOnWrite) { /* Last reference, the page is private now */
+
+            pte->isCopyOnWrite = FALSE;
+            pte->rwFlag = TRUE;
+
+        }
+
+        pte->inMemory = FALSE;
+        pte->isSwapped = TRUE;
+        pte->frameIndex = slot;
+
+    } else { /* Demand paging zeroes it or reads it from the file again */
+
+        Memory_set(pte, 0, sizeof(PageTableEntry));
+
+    }
+
+    if(isCurrent)
+        VirtualMemory_invalidateTLBEntry((void*) page);
+
+    PhysicalMemory_freeFrame(frame);
+
+    return TRUE;
+
+}
+
+/* Moves the clock hand through the user space of a process until "frames" are freed, returns the number freed */
+PRIVATE u32int VirtualMemory_reclaimFrom(Process* process, u32int frames, bool compress) {
+
+    PageDirectory* dir = VirtualMemory_mapFrame(process->pageDir, RECLAIM_DIR_VADDR);
+    bool isCurrent = VirtualMemory_isCurrentDir(process->pageDir);
+    u32int freed = 0;
+
+    while(clockPage < USER_STACK_TOP_VADDR && freed < frames) {
+
+        u32int index = PDE_INDEX(clockPage);
+        PageDirectoryEntry* pde = &dir->entries[index];
+
+        if(!pde->inMemory) { /* Skip the whole table */
+
+            clockPage = (index + 1) * LARGE_PAGE_SIZE;
+            continue;
+
+        }
+
+        PageTable* table = VirtualMemory_mapFrame(FRAME_INDEX_TO_ADDR(pde->frameIndex), RECLAIM_TABLE_VADDR);
+
+        for(; PDE_INDEX(clockPage) == index && clockPage < USER_STACK_TOP_VADDR && freed < frames; clockPage += FRAME_SIZE)
+            if(VirtualMemory_reclaimPage(&table->entries[PTE_INDEX(clockPage)], clockPage, isCurrent, compress))
+                freed++;
+
+        VirtualMemory_unmapFrame(table);
+
+    }
+
+    VirtualMemory_unmapFrame(dir);
+
+    return freed;
+
+}
+
+/* Frees the pages of a user page table and the table itself, frames go back to the physical memory manager in batches */
+PRIVATE void VirtualMemory_freeUserTable(PageDirectoryEntry* pde) {
+
+    void* frames[FREE_BATCH];
+    u32int count = 0;
+
+    PageTable* pageTable = (PageTable*) FRAME_INDEX_TO_ADDR(pde->frameIndex);
+    void* pageTablePhys = pageTable;
+    Debug_assert(pageTable != NULL);
+    pageTable = VirtualMemory_mapFrame(pageTable, (void*) TEMPORARY_MAP_VADDR + 0x1000); /* Map page table so that we can access it */
+
+    /* Free all page table entries*/
+    for(int y = 0; y < 1024; y++) {
+
+        PageTableEntry* pte = &pageTable->entries[y];
+
+        if(pte->inMemory && !pte->isShared) {
+
+            void* phys = FRAME_INDEX_TO_ADDR(pte->frameIndex);
+            Debug_assert(phys != NULL);
+
+            if(PhysicalMemory_dropFrameReference(phys)) /* Not shared with another process */
+                frames[count++] = phys;
+
+        } else if(pte->isSwapped) {
+
+            Swap_free(pte->frameIndex);
+
+        }
+
+        if(count == FREE_BATCH) {
+
+            PhysicalMemory_freeFrames(count, frames);
+            count = 0;
+
+        }
+
+    }
+
+    VirtualMemory_unmapFrame(pageTable);
+    frames[count++] = pageTablePhys; /* Batch always has room, it is flushed as soon as it fills */
+    PhysicalMemory_freeFrames(count, frames);
+    Memory_set(pde, 0, sizeof(PageDirectoryEntry));
+
+}
+
+/* Frees every user page and page table of a mapped page directory */
+PRIVATE void VirtualMemory_freeUserSpace(PageDirectory* dir) {
+
+    /* Free every page table starting at 1GB(everything except kernel which is bottom 4MB + kernel heap) */
+    for(int i = PDE_INDEX(USER_CODE_BASE_VADDR); i < 1023; i++)
+        if(dir->entries[i].inMemory)
+            VirtualMemory_freeUserTable(&dir->entries[i]);
+
+}
+
+PRIVATE void VirtualMemory_init(void) {
+
+    Debug_logInfo("%s%s", "Initialising ", vmmModule.moduleName);
+
+    /* Create the initial page directory */
+    PageDirectory* dir = PhysicalMemory_allocateFrame();
+    Memory_set(dir, 0, sizeof(PageDirectory));
+    VirtualMemory_switchPageDir(dir);
+    kernelDir = dir;
+
+    /* 4MB pages, saves TLB entries and page tables for memory the kernel touches constantly */
+    if(CPU_getFeatures() & CPU_FEATURE_PSE) {
+
+        u32int cr4 = CPU_getCR(4);
+        CR4 reg4 = FORCE_CAST(cr4, CR4);
+        reg4.PSE = TRUE;
+        CPU_setCR(4, FORCE_CAST(reg4, u32int));
+        largePages = TRUE;
+
+    }
+
+    if(largePages && !NULL_GUARD) { /* Identity map first 4MB with a single page, NULL is mapped too */
+
+        VirtualMemory_setLargePDE(&dir->entries[0], NULL, MODE_KERNEL);
+        dir->entries[0].globalPage = TRUE;
+
+    } else { /* Identity map first 4MB (except first 4096kb in order to catch NULLs) */
+
+        PageTable* first4MB = PhysicalMemory_allocateFrame();
+
+        for(int i = 1; i < 1024; i++) {
+
+            PageTableEntry* pte = &first4MB->entries[i];
+            VirtualMemory_setPTE(pte, FRAME_INDEX_TO_ADDR(i), MODE_KERNEL);
+            pte->isGlobal = TRUE;
+
+        }
+
+        VirtualMemory_setPDE(&dir->entries[0], first4MB, MODE_KERNEL);
+        dir->entries[0].globalPage = TRUE;
+
+    }
+    /* End of identity map */
+
+    /* Direct map physical memory, up to DIRECT_MAP_SIZE */
+    PhysicalMemoryInfo info;
+    u32int mapSize = (PhysicalMemory_getInfo(&info)->totalMemory + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1);
+
+    if(mapSize == 0 || mapSize > DIRECT_MAP_SIZE) /* Rounded past 4GB or window too small */
+        mapSize = DIRECT_MAP_SIZE;
+
+    for(u32int i = 0; i < mapSize / LARGE_PAGE_SIZE; i++) {
+
+        PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(DIRECT_MAP_VADDR) + i];
+        char* base = (char*) (i * LARGE_PAGE_SIZE);
+
+        if(largePages) {
+
+            VirtualMemory_setLargePDE(pde, base, MODE_KERNEL);
+
+        } else {
+
+            PageTable* pageTable = PhysicalMemory_allocateFrame();
+            Debug_assert(pageTable != NULL); /* Out of physical memory */
+
+            for(int y = 0; y < 1024; y++) {
+
+                VirtualMemory_setPTE(&pageTable->entries[y], base + y * FRAME_SIZE, MODE_KERNEL);
+                pageTable->entries[y].isGlobal = TRUE;
+
+            }
+
+            VirtualMemory_setPDE(pde, pageTable, MODE_KERNEL);
+
+        }
+
+        pde->globalPage = TRUE;
+
+    }
+
+    /* Kernel heap page tables, every address space shares these frames so heap mappings show up everywhere at once */
+    u32int heapSize = (PhysicalMemory_getInfo(&info)->totalMemory + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1);
+
+    if(heapSize == 0 || heapSize > KERNEL_HEAP_TOP_VADDR - KERNEL_HEAP_BASE_VADDR) /* Heap can't outgrow physical memory */
+        heapSize = KERNEL_HEAP_TOP_VADDR - KERNEL_HEAP_BASE_VADDR;
+
+    for(u32int i = 0; i < heapSize / LARGE_PAGE_SIZE; i++) {
+
+        PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(KERNEL_HEAP_BASE_VADDR) + i];
+        PageTable* pageTable = PhysicalMemory_allocateFrame();
+        Debug_assert(pageTable != NULL); /* Out of physical memory */
+
+        Memory_set(pageTable, 0, sizeof(PageTable));
+        VirtualMemory_setPDE(pde, pageTable, MODE_KERNEL);
+        pde->globalPage = TRUE;
+
+    }
+
+    kernelHeapLimit = KERNEL_HEAP_BASE_VADDR + heapSize;
+
+    /* Shared zero page, every address space maps it read only */
+    zeroFrame = PhysicalMemory_allocateFrame();
+    Debug_assert(zeroFrame != NULL); /* Out of physical memory */
+    Memory_set(zeroFrame, 0, FRAME_SIZE);
+
+    /* Map directory to last virtual 4MB - recursive mapping, lets us manipulate the page directory after paging is enabled */
+    dir->entries[1023].frameIndex = ADDR_TO_FRAME_INDEX(dir);
+    dir->entries[1023].inMemory = TRUE;
+    dir->entries[1023].rwFlag = TRUE;
+    dir->entries[1023].mode = MODE_KERNEL;
+
+    /* Register page fault handler */
+    IDT_registerHandler(&VirtualMemory_pageFaultHandler, 14);
+
+    /* Turn on paging */
+    VirtualMemory_setPaging(TRUE);
+    directMapSize = mapSize;
+
+    /* Make kernel writes to read only user pages fault too, so shared pages are copied on write */
+    u32int cr0 = CPU_getCR(0);
+    CR0 reg = FORCE_CAST(cr0, CR0);
+    reg.WP = TRUE;
+    CPU_setCR(0, FORCE_CAST(reg, u32int));
+
+    /* Keep global(kernel) translations in the TLB across address space switches */
+    if(CPU_getFeatures() & CPU_FEATURE_PGE) {
+
+        u32int cr4 = CPU_getCR(4);
+        CR4 reg4 = FORCE_CAST(cr4, CR4);
+        reg4.PGE = TRUE;
+        CPU_setCR(4, FORCE_CAST(reg4, u32int));
+
+    }
+
+}
+
+PUBLIC void* VirtualMemory_quickMap(void* virtualAddr, void* physicalAddr) {
+
+    /* Map to current page dir */
+
+    /* Addresses should be page aligned */
+    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0 && (u32int) physicalAddr % FRAME_SIZE == 0);
+
+    PageDirectory* dir = (PageDirectory*) 0xFFFFF000; /* Get current page directory */
+    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+
+    if(!pde->inMemory) { /* Need to allocate a page table */
+
+        PageTable* pageTable = PhysicalMemory_allocateFrame();
+
+        Debug_assert(pageTable != NULL); /* Out of physical memory */
+
+        VirtualMemory_setPDE(pde, pageTable, MODE_KERNEL);
+        pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
+        Memory_set(pageTable, 0, sizeof(PageTable));
+
+    }
+
+    PageTable* pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
+    PageTableEntry* pte = &pageTable->entries[PTE_INDEX(virtualAddr)];
+    VirtualMemory_setPTE(pte, physicalAddr, MODE_KERNEL);
+    VirtualMemory_invalidateTLBEntry(virtualAddr);
+
+    return virtualAddr;
+
+}
+
+PUBLIC void VirtualMemory_quickUnmap(void* virtualAddr) {
+
+    /* Unmap from current page dir */
+
+    /* Address should be page aligned */
+    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0);
+
+    PageDirectory* dir = (PageDirectory*) 0xFFFFF000; /* Get current page directory */
+    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+
+    Debug_assert(pde->inMemory);
+
+    PageTable* pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
+    PageTableEntry* pte = &pageTable->entries[PTE_INDEX(virtualAddr)];
+
+    Debug_assert(pte->inMemory);
+
+    Memory_set(pte, 0, sizeof(PageTableEntry));
+    VirtualMemory_invalidateTLBEntry(virtualAddr);
+
+}
+
+PUBLIC void* VirtualMemory_physToVirt(void* physicalAddr) {
+
+    if((u32int) physicalAddr >= directMapSize) /* Outside of the window */
+        return NULL;
+
+    return (char*) DIRECT_MAP_VADDR + (u32int) physicalAddr;
+
+}
+
+PUBLIC void* VirtualMemory_virtToPhys(void* virtualAddr) {
+
+    Debug_assert((u32int) virtualAddr >= DIRECT_MAP_VADDR && (u32int) virtualAddr < DIRECT_MAP_VADDR + directMapSize);
+
+    return (void*) ((u32int) virtualAddr - DIRECT_MAP_VADDR);
+
+}
+
+PUBLIC void* VirtualMemory_mapFrame(void* physicalAddr, void* fallbackAddr) {
+
+    void* virtualAddr = VirtualMemory_physToVirt(physicalAddr);
+
+    if(virtualAddr == NULL) /* Not direct mapped */
+        virtualAddr = VirtualMemory_quickMap(fallbackAddr, physicalAddr);
+
+    return virtualAddr;
+
+}
+
+PUBLIC void VirtualMemory_unmapFrame(void* virtualAddr) {
+
+    if(!IS_DIRECT_MAPPED(virtualAddr))
+        VirtualMemory_quickUnmap(virtualAddr);
+
+}
+
+PUBLIC PageDirectory* VirtualMemory_getKernelDir(void) {
+
+    return kernelDir;
+
+}
+
+PUBLIC void VirtualMemory_switchPageDir(PageDirectory* dir) {
+
+    Debug_assert(dir != NULL);
+
+    /* Set page directory base register */
+    u32int cr3 = CPU_getCR(3);
+    CR3 reg = FORCE_CAST(cr3, CR3);
+    reg.PDBR = (u32int) &dir->entries / FRAME_SIZE;
+    CPU_setCR(3, FORCE_CAST(reg, u32int)); /* Flushes every non global TLB entry */
+
+}
+
+PUBLIC void VirtualMemory_createPageDirectory(Process* process) {
+
+    Debug_assert(process->pageDir == NULL);
+
+    PageDirectory* dir = (PageDirectory*) PhysicalMemory_allocateFrame();
+    process->pageDir = dir;
+    dir = VirtualMemory_mapFrame(dir, (void*) TEMPORARY_MAP_VADDR); /* Map it so that we can access it */
+    PageDirectory* kDir = VirtualMemory_mapFrame(kernelDir, (void*) (TEMPORARY_MAP_VADDR + 0x1000));
+
+    /* Kernel page tables are shared by reference: bottom 4MB, physical memory window and kernel heap */
+    Memory_copy(dir, kDir, PDE_INDEX(USER_CODE_BASE_VADDR) * sizeof(PageDirectoryEntry));
+    Memory_set(&dir->entries[PDE_INDEX(USER_CODE_BASE_VADDR)], 0, (1024 - PDE_INDEX(USER_CODE_BASE_VADDR)) * sizeof(PageDirectoryEntry));
+
+    /* Temporary mappings are private to every address space */
+    Memory_set(&dir->entries[PDE_INDEX(TEMPORARY_MAP_VADDR)], 0, sizeof(PageDirectoryEntry));
+
+    VirtualMemory_unmapFrame(kDir);
+
+    /* Map directory to last virtual 4MB - recursive mapping, lets us manipulate the page directory after paging is enabled */
+    dir->entries[1023].frameIndex = (ADDR_TO_FRAME_INDEX(process->pageDir));
+    dir->entries[1023].inMemory = TRUE;
+    dir->entries[1023].rwFlag = TRUE;
+    dir->entries[1023].mode = MODE_KERNEL;
+
+    VirtualMemory_unmapFrame(dir);
+
+}
+
+PUBLIC void VirtualMemory_destroyPageDirectory(Process* process) {
+
+    Debug_assert(process->pageDir != NULL);
+
+    /* Map page directory so that we can access it */
+    PageDirectory* dir = VirtualMemory_mapFrame(process->pageDir, (void*) TEMPORARY_MAP_VADDR);
+    VirtualMemory_freeUserSpace(dir);
+    VirtualMemory_freeMappings(process);
+
+    /* Page table of the temporary mappings, allocated by VirtualMemory_quickMap */
+    PageDirectoryEntry* temporary = &dir->entries[PDE_INDEX(TEMPORARY_MAP_VADDR)];
+    void* temporaryTable = temporary->inMemory ? FRAME_INDEX_TO_ADDR(temporary->frameIndex) : NULL;
+
+    VirtualMemory_unmapFrame(dir);
+    PhysicalMemory_freeFrame(process->pageDir);
+
+    if(temporaryTable != NULL)
+        PhysicalMemory_freeFrame(temporaryTable);
+
+}
+
+PUBLIC bool VirtualMemory_releaseUserTable(Process* process) {
+
+    Debug_assert(process->pageDir != NULL && !VirtualMemory_isCurrentDir(process->pageDir));
+
+    PageDirectory* dir = VirtualMemory_mapFrame(process->pageDir, (void*) TEMPORARY_MAP_VADDR);
+    bool released = FALSE;
+
+    for(int i = PDE_INDEX(USER_CODE_BASE_VADDR); i < 1023 && !released; i++) {
+
+        if(dir->entries[i].inMemory) {
+
+            VirtualMemory_freeUserTable(&dir->entries[i]);
+            released = TRUE;
+
+        }
+
+    }
+
+    VirtualMemory_unmapFrame(dir);
+
+    return released;
+
+}
+
+PUBLIC void VirtualMemory_resetPageDirectory(Process* process) {
+
+    Debug_assert(process->pageDir != NULL);
+
+    PageDirectory* dir = VirtualMemory_mapFrame(process->pageDir, (void*) TEMPORARY_MAP_VADDR);
+    VirtualMemory_freeUserSpace(dir);
+    VirtualMemory_unmapFrame(dir);
+    VirtualMemory_freeMappings(process);
+
+    /* Stale user translations if the directory is the current one */
+    if(VirtualMemory_isCurrentDir(process->pageDir))
+        VirtualMemory_invalidateTLB();
+
+}
+
+PUBLIC void VirtualMemory_cloneAddressSpace(Process* process) {
+
+    Debug_assert(process != NULL && process->pageDir != NULL);
+
+    /* Current page directory and its page tables are reachable through the recursive mapping */
+    PageDirectory* current = (PageDirectory*) 0xFFFFF000;
+    PageDirectory* dir = VirtualMemory_mapFrame(process->pageDir, (void*) TEMPORARY_MAP_VADDR);
+
+    for(int i = PDE_INDEX(USER_CODE_BASE_VADDR); i < 1023; i++) {
+
+        if(!current->entries[i].inMemory)
+            continue;
+
+        PageTable* table = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * i));
+        PageTable* cloneTable = PhysicalMemory_allocateZeroedFrame();
+        Debug_assert(cloneTable != NULL); /* Out of physical memory */
+
+        VirtualMemory_setPDE(&dir->entries[i], cloneTable, current->entries[i].mode);
+        cloneTable = VirtualMemory_mapFrame(cloneTable, (void*) TEMPORARY_MAP_VADDR + 0x1000);
+
+        for(int y = 0; y < 1024; y++) {
+
+            PageTableEntry* pte = &table->entries[y];
+
+            if(pte->isSwapped) { /* Child gets its own compressed copy */
+
+                cloneTable->entries[y] = *pte;
+                cloneTable->entries[y].frameIndex = Swap_duplicate(pte->frameIndex);
+                continue;
+
+            }
+
+            if(!pte->inMemory)
+                continue;
+
+            if(!pte->isShared) { /* Frame now belongs to both, whoever writes first gets a copy */
+
+                if(pte->rwFlag) {
+
+                    pte->rwFlag = FALSE;
+                    pte->isCopyOnWrite = TRUE;
+
+                }
+
+                PhysicalMemory_addFrameReference(FRAME_INDEX_TO_ADDR(pte->frameIndex));
+
+            }
+
+            cloneTable->entries[y] = *pte;
+
+        }
+
+        VirtualMemory_unmapFrame(cloneTable);
+
+    }
+
+    VirtualMemory_unmapFrame(dir);
+
+    /* Current mappings were made read only */
+    VirtualMemory_invalidateTLB();
+
+    /* Child inherits the memory mappings, pages were shared above */
+    Process* parent = Scheduler_getCurrentProcess();
+
+    for(u32int i = 0; parent->mappings != NULL && i < ArrayList_getSize(parent->mappings); i++) {
+
+        MemoryMapping* mapping = HeapMemory_alloc(sizeof(MemoryMapping));
+        Debug_assert(mapping != NULL);
+        Memory_copy(mapping, ArrayList_get(parent->mappings, i), sizeof(MemoryMapping));
+
+        if(process->mappings == NULL)
+            process->mappings = ArrayList_new(ArrayList_getSize(parent->mappings));
+
+        ArrayList_add(process->mappings, mapping);
+
+    }
+
+}
+
+PUBLIC void* VirtualMemory_mapRange(PageDirectory* dir, void* virtualAddr, void** physicalAddrs, u32int count, bool mode) {
+
+    /* Address should be page aligned */
+    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0);
+    Debug_assert(dir != NULL);
+
+    /* Directory and the current page table stay mapped for the whole run */
+    dir = VirtualMemory_mapFrame(dir, (void*) TEMPORARY_MAP_VADDR);
+    PageTable* pageTable = NULL;
+
+    for(u32int i = 0; i < count; i++) {
+
+        char* page = (char*) virtualAddr + i * FRAME_SIZE;
+        Debug_assert((u32int) physicalAddrs[i] % FRAME_SIZE == 0);
+
+        if(pageTable == NULL || PTE_INDEX(page) == 0) { /* Entering a new page table */
+
+            PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(page)];
+
+            if(!pde->inMemory) { /* Need to allocate a page table */
+
+                /* Kernel page tables are allocated at boot, a new one would not be shared */
+                Debug_assert(!IS_KERNEL_PAGE(page));
+
+                PageTable* newTable = PhysicalMemory_allocateZeroedFrame();
+
+                Debug_assert(newTable != NULL); /* Out of physical memory */
+
+                VirtualMemory_setPDE(pde, newTable, mode);
+
+            }
+
+            if(pageTable != NULL)
+                VirtualMemory_unmapFrame(pageTable);
+
+            pageTable = VirtualMemory_mapFrame(FRAME_INDEX_TO_ADDR(pde->frameIndex), (void*) TEMPORARY_MAP_VADDR + 0x1000);
+
+        }
+
+        PageTableEntry* pte = &pageTable->entries[PTE_INDEX(page)];
+        VirtualMemory_setPTE(pte, physicalAddrs[i], mode);
+        pte->isGlobal = IS_KERNEL_PAGE(page);
+        VirtualMemory_invalidateTLBEntry(page);
+
+    }
+
+    VirtualMemory_unmapFrame(dir);
+
+    if(pageTable != NULL)
+        VirtualMemory_unmapFrame(pageTable);
+
+    return virtualAddr;
+
+}
+
+PUBLIC u32int VirtualMemory_unmapRange(PageDirectory* dir, void* virtualAddr, u32int count, void** physicalAddrs) {
+
+    /* Address should be page aligned */
+    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0);
+    Debug_assert(dir != NULL);
+
+    /* Directory and the current page table stay mapped for the whole run */
+    dir = VirtualMemory_mapFrame(dir, (void*) TEMPORARY_MAP_VADDR);
+    PageTable* pageTable = NULL;
+    u32int unmapped = 0;
+
+    for(u32int i = 0; i < count; i++) {
+
+        char* page = (char*) virtualAddr + i * FRAME_SIZE;
+        PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(page)];
+
+        if(!pde->inMemory) /* No page table, nothing mapped */
+            continue;
+
+        Debug_assert(!pde->pageSize);
+
+        if(pageTable == NULL || PTE_INDEX(page) == 0) { /* Entering a new page table */
+
+            if(pageTable != NULL)
+                VirtualMemory_unmapFrame(pageTable);
+
+            pageTable = VirtualMemory_mapFrame(FRAME_INDEX_TO_ADDR(pde->frameIndex), (void*) TEMPORARY_MAP_VADDR + 0x1000);
+
+        }
+
+        PageTableEntry* pte = &pageTable->entries[PTE_INDEX(page)];
+
+        if(pte->isSwapped) { /* User pages only, kernel pages are never reclaimed */
+
+            Swap_free(pte->frameIndex);
+            Memory_set(pte, 0, sizeof(PageTableEntry));
+            continue;
+
+        }
+
+        if(!pte->inMemory)
+            continue;
+
+        if(!pte->isShared) { /* Shared frames(zero page, ramdisk) are not ours to give back */
+
+            if(physicalAddrs != NULL)
+                physicalAddrs[unmapped] = FRAME_INDEX_TO_ADDR(pte->frameIndex);
+
+            unmapped++;
+
+        }
+
+        Memory_set(pte, 0, sizeof(PageTableEntry));
+        VirtualMemory_invalidateTLBEntry(page);
+
+    }
+
+    VirtualMemory_unmapFrame(dir);
+
+    if(pageTable != NULL)
+        VirtualMemory_unmapFrame(pageTable);
+
+    return unmapped;
+
+}
+
+PUBLIC void* VirtualMemory_mapPage(PageDirectory* dir, void* virtualAddr, void* physicalAddr, bool mode) {
+
+    return VirtualMemory_mapRange(dir, virtualAddr, &physicalAddr, 1, mode);
+
+}
+
+PUBLIC void VirtualMemory_unmapPage(PageDirectory* dir, void* virtualAddr) {
+
+    VirtualMemory_unmapRange(dir, virtualAddr, 1, NULL);
+
+}
+
+PUBLIC void* VirtualMemory_mmap(void* addr, u32int length, VFSNode* file, u32int offset) {
+
+    Process* process = Scheduler_getCurrentProcess();
+    Debug_assert(process != NULL && process->pid != KERNEL_PID);
+
+    u32int pages = (length + FRAME_SIZE - 1) / FRAME_SIZE;
+
+    if(pages == 0 || pages > (USER_MMAP_TOP_VADDR - USER_CODE_BASE_VADDR) / FRAME_SIZE)
+        return NULL;
+
+    if(file != NULL) { /* Open normal file, starting at a page boundary inside it */
+
+        if(file->fileType != FILETYPE_NORMAL || file->mode == FILE_MODE_NOT_OPEN)
+            return NULL;
+
+        if(offset % FRAME_SIZE != 0 || offset >= file->fileSize)
+            return NULL;
+
+    }
+
+    u32int start = (u32int) addr & ~(FRAME_SIZE - 1);
+
+    if(addr == NULL || !VirtualMemory_isRangeFree(process, start, start + pages * FRAME_SIZE)) { /* Hint is only a hint, find the first gap */
+
+        start = USER_MMAP_BASE_VADDR;
+
+        for(u32int i = 0; process->mappings != NULL && i < ArrayList_getSize(process->mappings); i++) {
+
+            MemoryMapping* mapping = ArrayList_get(process->mappings, i);
+
+            if(start < mapping->start + mapping->pages * FRAME_SIZE && start + pages * FRAME_SIZE > mapping->start) {
+
+                start = mapping->start + mapping->pages * FRAME_SIZE; /* Move past it and rescan */
+                i = -1;
+
+            }
+
+        }
+
+        if(!VirtualMemory_isRangeFree(process, start, start + pages * FRAME_SIZE))
+            return NULL;
+
+    }
+
+    MemoryMapping* mapping = HeapMemory_alloc(sizeof(MemoryMapping));
+    Debug_assert(mapping != NULL);
+
+    mapping->start = start;
+    mapping->pages = pages;
+    mapping->file = file;
+    mapping->offset = offset;
+
+    if(process->mappings == NULL)
+        process->mappings = ArrayList_new(4);
+
+    ArrayList_add(process->mappings, mapping);
+
+    return (void*) start;
+
+}
+
+PUBLIC bool VirtualMemory_munmap(void* addr, u32int length) {
+
+    Process* process = Scheduler_getCurrentProcess();
+    Debug_assert(process != NULL && process->pid != KERNEL_PID);
+
+    u32int start = (u32int) addr;
+    u32int end = start + ((length + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1));
+
+    if(start % FRAME_SIZE != 0 || start < USER_CODE_BASE_VADDR || end > USER_MMAP_TOP_VADDR || end <= start)
+        return FALSE;
+
+    for(u32int i = 0; process->mappings != NULL && i < ArrayList_getSize(process->mappings); i++) {
+
+        MemoryMapping* mapping = ArrayList_get(process->mappings, i);
+        u32int mappingEnd = mapping->start + mapping->pages * FRAME_SIZE;
+
+        if(start >= mappingEnd || end <= mapping->start)
+            continue;
+
+        /* Part of the mapping inside the range */
+        u32int cutStart = start > mapping->start ? start : mapping->start;
+        u32int cutEnd = end < mappingEnd ? end : mappingEnd;
+        VirtualMemory_freeUserPages(cutStart, (cutEnd - cutStart) / FRAME_SIZE);
+
+        if(cutStart == mapping->start && cutEnd == mappingEnd) { /* Whole mapping is gone */
+
+            ArrayList_removeAt(process->mappings, i);
+            HeapMemory_free(mapping);
+            i--;
+
+        } else if(cutStart == mapping->start) { /* Head is gone */
+
+            mapping->offset += cutEnd - mapping->start;
+            mapping->start = cutEnd;
+            mapping->pages = (mappingEnd - cutEnd) / FRAME_SIZE;
+
+        } else { /* Tail is gone, a hole in the middle leaves a new mapping behind it */
+
+            mapping->pages = (cutStart - mapping->start) / FRAME_SIZE;
+
+            if(cutEnd < mappingEnd) {
+
+                MemoryMapping* tail = HeapMemory_alloc(sizeof(MemoryMapping));
+                Debug_assert(tail != NULL);
+
+                tail->start = cutEnd;
+                tail->pages = (mappingEnd - cutEnd) / FRAME_SIZE;
+                tail->file = mapping->file;
+                tail->offset = mapping->offset + (cutEnd - mapping->start);
+                ArrayList_add(process->mappings, tail);
+
+            }
+
+        }
+
+    }
+
+    return TRUE;
+
+}
+
+PUBLIC u32int VirtualMemory_reclaim(u32int frames, bool compress) {
+
+    if(reclaiming) /* Storing a page grew the heap, which ran out of frames */
+        return 0;
+
+    reclaiming = TRUE;
+    u32int freed = 0;
+    u32int wraps = 0;
+
+    /* Pages accessed since the hand last passed are skipped, so it may take two full turns */
+    while(freed < frames && wraps < 3) {
+
+        Process* process = ProcessManager_getProcess(clockProcess);
+
+        if(process == NULL) { /* Past the last process, start over */
+
+            clockProcess = 0;
+            clockPage = USER_CODE_BASE_VADDR;
+            wraps++;
+
+            if(ProcessManager_getProcess(0) == NULL)
+                break;
+
+            continue;
+
+        }
+
+        freed += VirtualMemory_reclaimFrom(process, frames - freed, compress);
+
+        if(clockPage >= USER_STACK_TOP_VADDR) {
+
+            clockProcess++;
+            clockPage = USER_CODE_BASE_VADDR;
+
+        }
+
+    }
+
+    reclaiming = FALSE;
+
+    return freed;
+
+}
+
+PUBLIC void* VirtualMemory_getPhysicalAddress(void* virtualAddr) {
+
+    /* Address should be page aligned */
+    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0);
+
+    PageDirectory* dir = (PageDirectory*) 0xFFFFF000;
+    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+
+    Debug_assert(pde->inMemory);
+
+    if(pde->pageSize) /* 4MB page, no page table */
+        return (char*) FRAME_INDEX_TO_ADDR(pde->frameIndex) + ((u32int) virtualAddr & (LARGE_PAGE_SIZE - 1));
+
+    PageTable* pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
+    PageTableEntry* pte = &pageTable->entries[PTE_INDEX(virtualAddr)];
+
+    Debug_assert(pte->inMemory);
+
+    return (void*) FRAME_INDEX_TO_ADDR(pte->frameIndex);
+}
+
+PUBLIC bool VirtualMemory_isMapped(void* virtualAddr) {
+
+    /* Address should be page aligned */
+    Debug_assert((u32int) virtualAddr % FRAME_SIZE == 0);
+
+    PageDirectory* dir = (PageDirectory*) 0xFFFFF000;
+    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+
+    if(!pde->inMemory)
+        return FALSE;
+
+    if(pde->pageSize)
+        return TRUE;
+
+    PageTable* pageTable = (PageTable*) (((u32int*) 0xFFC00000) + (0x400 * PDE_INDEX(virtualAddr)));
+    return pageTable->entries[PTE_INDEX(virtualAddr)].inMemory;
+
+}
+
+PUBLIC bool VirtualMemory_hasLargePages(void) {
+
+    return largePages;
+
+}
+
+PUBLIC bool VirtualMemory_isLargePage(void* virtualAddr) {
+
+    PageDirectory* dir = (PageDirectory*) 0xFFFFF000;
+    PageDirectoryEntry* pde = &dir->entries[PDE_INDEX(virtualAddr)];
+
+    return pde->inMemory && pde->pageSize;
+
+}
+
+PUBLIC void* VirtualMemory_getKernelHeapLimit(void) {
+
+    return (void*) kernelHeapLimit;
 
-    return (void*) FRAME_INDEX_TO_ADDR(pte->frameIndex);
 }
 
 PUBLIC Module* VirtualMemory_getModule(void) {
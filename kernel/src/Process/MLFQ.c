@@ -0,0 +1,238 @@
+/**
+| Copyright(C) 2012 Ali Ersenal
+| License: WTFPL v2
+| URL: http://sam.zoy.org/wtfpl/COPYING
+|
+|--------------------------------------------------------------------------
+| MLFQ.c (implements Scheduler)
+|--------------------------------------------------------------------------
+|
+| DESCRIPTION:  Multi-level feedback queue process scheduler implementation.
+|
+|               Processes are kept in MLFQ_LEVELS round robin queues, a
+|               process runs only if every higher queue has nothing to
+|               run. Lower queues get longer quanta. A process that uses up
+|               its quantum moves down a queue, so CPU bound processes sink
+|               while processes that block early stay on top.
+|
+|               A process woken by keyboard input is boosted to the top,
+|               and every MLFQ_BOOST_PERIOD ticks all processes are, so
+|               nothing starves. The nice value caps how high a process
+|               can go.
+|
+|               The idle(kernel) process is kept out of the queues. It runs
+|               when nothing else can, and for a tick every
+|               MLFQ_IDLE_PERIOD ticks otherwise, so that killed processes
+|               are torn down(see Kernel_idle) under CPU bound load too.
+|
+| AUTHOR:       Ali Ersenal, aliersenal@gmail.com
+\------------------------------------------------------------------------*/
+
+
+#include <Process/MLFQ.h>
+#include <Lib/LinkedList.h>
+#include <Debug.h>
+#include <Common.h>
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define MLFQ_LEVELS        4
+#define MLFQ_BOOST_PERIOD  100 /* Ticks, 1 second */
+#define MLFQ_IDLE_PERIOD   20  /* Ticks, idle gets at least 1 of these. Halts if it has no work, costing the tick */
+
+/* Highest queue a process may be in */
+#define MLFQ_TOP(process)  ((process)->nice * MLFQ_LEVELS / (PROCESS_NICE_MAX + 1))
+
+/*=======================================================
+    PRIVATE DATA
+=========================================================*/
+PRIVATE LinkedList* queues[MLFQ_LEVELS];
+PRIVATE const u32int quantum[MLFQ_LEVELS] = {2, 4, 8, 16}; /* Ticks, 2 ticks is 20ms */
+PRIVATE Process* currentProcess;
+PRIVATE Process* idleProcess;
+PRIVATE u32int   ticks;     /* Since the last boost */
+PRIVATE u32int   idleTicks; /* Since idle last ran */
+
+/*=======================================================
+    FUNCTION
+=========================================================*/
+
+/* Moves a queued process to the end of "level" */
+PRIVATE void MLFQ_move(Process* process, u32int level) {
+
+    LinkedList_remove(queues[process->priority], process);
+    process->priority = level;
+    LinkedList_add(queues[level], process);
+
+}
+
+/* Highest queue that has a process which is not blocked, MLFQ_LEVELS if none */
+PRIVATE u32int MLFQ_getRunnableLevel(void) {
+
+    for(u32int level = 0; level < MLFQ_LEVELS; level++) {
+
+        for(Node* node = queues[level]->first; node != NULL; node = node->next) {
+
+            if(((Process*) node->data)->status != PROCESS_BLOCKED)
+                return level;
+
+        }
+
+    }
+
+    return MLFQ_LEVELS;
+
+}
+
+/* Anti-starvation, every process goes back to its top queue with a fresh quantum */
+PRIVATE void MLFQ_boostAll(void) {
+
+    for(u32int level = 0; level < MLFQ_LEVELS; level++) {
+
+        for(u32int count = queues[level]->count; count > 0; count--) {
+
+            Process* process = LinkedList_getFront(queues[level]);
+            process->ticks = 0;
+            MLFQ_move(process, MLFQ_TOP(process)); /* Goes to the end of a higher queue, or of this one */
+
+        }
+
+    }
+
+}
+
+PUBLIC void MLFQ_addProcess(Process* process) {
+
+    Debug_assert(process != NULL);
+
+    if(queues[0] == NULL) { /* MLFQ initialisation */
+
+        for(u32int level = 0; level < MLFQ_LEVELS; level++)
+            queues[level] = LinkedList_new();
+
+    }
+
+    if(currentProcess == NULL)
+        currentProcess = process;
+
+    process->status = PROCESS_WAITING;
+
+    if(process->pid == KERNEL_PID) { /* Idle process, see MLFQ_IDLE_PERIOD */
+
+        idleProcess = process;
+        return;
+
+    }
+
+    process->priority = MLFQ_TOP(process);
+    process->ticks = 0;
+    LinkedList_add(queues[process->priority], process);
+
+}
+
+PUBLIC void MLFQ_removeProcess(Process* process) {
+
+    Debug_assert(process != NULL && queues[0] != NULL);
+    Debug_assert(process->pid != KERNEL_PID); /* Can't remove kernel process */
+
+    process->status = PROCESS_TERMINATED;
+    LinkedList_remove(queues[process->priority], process);
+
+}
+
+PUBLIC Process* MLFQ_getNextProcess(void) {
+
+    Process* current = currentProcess;
+
+    /* Round robin within a queue, the switched out process goes to the end. A raised nice value takes effect here */
+    if(current != idleProcess && current->status != PROCESS_TERMINATED)
+        MLFQ_move(current, current->priority < MLFQ_TOP(current) ? MLFQ_TOP(current) : current->priority);
+
+    u32int level = MLFQ_getRunnableLevel();
+    currentProcess = idleProcess;
+
+    if(level < MLFQ_LEVELS && (idleTicks < MLFQ_IDLE_PERIOD || idleProcess == NULL)) {
+
+        for(Node* node = queues[level]->first; node != NULL; node = node->next) {
+
+            if(((Process*) node->data)->status != PROCESS_BLOCKED) {
+
+                currentProcess = node->data;
+                break;
+
+            }
+
+        }
+
+    }
+
+    Debug_assert(currentProcess != NULL);
+
+    if(currentProcess == idleProcess)
+        idleTicks = 0;
+
+    return currentProcess;
+
+}
+
+PUBLIC Process* MLFQ_getCurrentProcess(void) {
+
+    return currentProcess;
+
+}
+
+PUBLIC bool MLFQ_tick(void) {
+
+    Process* current = currentProcess;
+
+    if(current == NULL) /* Nothing is running yet */
+        return FALSE;
+
+    if(++ticks >= MLFQ_BOOST_PERIOD) {
+
+        ticks = 0;
+        MLFQ_boostAll();
+
+    }
+
+    if(current == idleProcess) /* Idle runs until anything else can */
+        return MLFQ_getRunnableLevel() < MLFQ_LEVELS;
+
+    idleTicks++;
+
+    if(current->status == PROCESS_BLOCKED || current->status == PROCESS_TERMINATED) /* Gave up the CPU, see ProcessManager_forceSwitch */
+        return TRUE;
+
+    /* Ticks add up over blocking, so yielding just before the quantum ends does not keep a process up */
+    if(++current->ticks >= quantum[current->priority]) { /* Quantum used up, move down */
+
+        current->ticks = 0;
+
+        if(current->priority < MLFQ_LEVELS - 1)
+            MLFQ_move(current, current->priority + 1);
+
+        return TRUE;
+
+    }
+
+    if(idleTicks >= MLFQ_IDLE_PERIOD && idleProcess != NULL) /* Idle's turn */
+        return TRUE;
+
+    return MLFQ_getRunnableLevel() < current->priority; /* Preempted by a higher queue */
+
+}
+
+PUBLIC void MLFQ_boostProcess(Process* process) {
+
+    Debug_assert(process != NULL);
+
+    if(process == idleProcess || process->status == PROCESS_TERMINATED)
+        return;
+
+    process->ticks = 0;
+
+    if(process->priority != MLFQ_TOP(process))
+        MLFQ_move(process, MLFQ_TOP(process));
+
+}
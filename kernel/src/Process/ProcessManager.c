@@ -19,16 +19,22 @@
 #include <Memory/VirtualMemory.h>
 #include <Memory/HeapMemory.h>
 #include <Memory/PhysicalMemory.h>
+#include <Memory/Slab.h>
 #include <Memory.h>
 #include <Lib/String.h>
 #include <X86/GDT.h>
 #include <Process/Mutex.h>
+#include <Lib/Stack.h>
+#include <X86/CPU.h>
 
 /*=======================================================
     DEFINE
 =========================================================*/
 #define PROCESS_MSG_WAITING 0x100
 
+#define PROCESS_POOL_SIZE      4   /* Maximum number of ready address spaces */
+#define PROCESS_POOL_MIN_FREE  512 /* Stop refilling when fewer frames are free */
+
 /*=======================================================
     STRUCT
 =========================================================*/
@@ -53,19 +59,28 @@ PUBLIC Process*  kernelProcess;
 PRIVATE Module     pmModule;
 PRIVATE u32int     pid;
 PRIVATE ArrayList* globalMailbox;
+PRIVATE ArrayList* processes; /* Every user process, walked by the page reclaimer */
+PRIVATE ArrayList* reaperQueue; /* Killed processes waiting to be torn down, see ProcessManager_reap */
+PRIVATE SlabCache* processCache;
+PRIVATE SlabCache* messageCache;
+
+/* Processes with a ready address space(directory, kernel stack, user stack), see ProcessManager_refillPool */
+PRIVATE void*      processPoolEntries[PROCESS_POOL_SIZE];
+PRIVATE Stack      processPool;
+
+#ifdef BENCHMARK
+PRIVATE bool       spawnBypassPool; /* Every other spawn builds its address space from scratch */
+PRIVATE bool       spawnPooled;
+PRIVATE Process*   spawnMeasured;
+PRIVATE u64int     spawnBegin;
+#endif
 
 /*=======================================================
     FUNCTION
 =========================================================*/
 
-PRIVATE Process* ProcessManager_newProcess(void) {
-
-    Process* self = HeapMemory_calloc(1, sizeof(Process));
-    Debug_assert(self != NULL);
-
-    self->pid = pid;
-    self->userHeapTop = (void*) USER_HEAP_BASE_VADDR;
-    self->fileNodes = ArrayList_new(1);
+/* Allocates and maps the user stack, with the initial user mode context on top */
+PRIVATE void ProcessManager_initUserStack(Process* self) {
 
     Regs registers;
     Memory_set(&registers, 0, sizeof(Regs));
@@ -81,19 +96,7 @@ PRIVATE Process* ProcessManager_newProcess(void) {
     registers.fs = USER_DATA_SEGMENT | 3;
     registers.gs = USER_DATA_SEGMENT | 3;
 
-    /* Create a new page directory for process */
-    VirtualMemory_createPageDirectory(self);
-
-    /* Map kernel bottom 4MB + kernel heap */
-    VirtualMemory_mapKernel(self);
-
-    /* Allocate kernel stack - 4KB */
-    u32int* stack = HeapMemory_calloc(1, FRAME_SIZE);
-    Debug_assert(stack != NULL);
-    self->kernelStackBase = stack;
-    self->kernelStack = (char*) stack + FRAME_SIZE;
-
-    /* Allocate and map user stack - Currently 4KB */
+    /* Allocate and map the top of user stack - 4KB, the rest is mapped on first touch */
     Debug_assert(USER_STACK_SIZE == FRAME_SIZE);
     self->userStackBase = (void*) USER_STACK_BASE_VADDR;
     char* uStack = PhysicalMemory_allocateFrame();
@@ -112,12 +115,65 @@ PRIVATE Process* ProcessManager_newProcess(void) {
 
     } else {
 
-        VirtualMemory_quickMap((void*) TEMPORARY_MAP_VADDR, uStack);
-        Memory_copy((void*) (TEMPORARY_MAP_VADDR + FRAME_SIZE - sizeof(Regs)), &registers, sizeof(Regs));
-        VirtualMemory_quickUnmap((void*) TEMPORARY_MAP_VADDR);
+        char* stackPage = VirtualMemory_mapFrame(uStack, (void*) TEMPORARY_MAP_VADDR);
+        Memory_copy(stackPage + FRAME_SIZE - sizeof(Regs), &registers, sizeof(Regs));
+        VirtualMemory_unmapFrame(stackPage);
 
     }
 
+}
+
+/* Builds a process with an address space that is ready to run user code */
+PRIVATE Process* ProcessManager_newAddressSpace(void) {
+
+    Process* self = Slab_alloc(processCache);
+    Debug_assert(self != NULL);
+
+    /* Create a new page directory for process */
+    VirtualMemory_createPageDirectory(self);
+
+    /* Allocate kernel stack - 4KB, no need to zero it. It stays with the address space when that is pooled */
+    u32int owner = HeapMemory_setOwner(HEAP_OWNER_KERNEL);
+    u32int* stack = HeapMemory_alloc(FRAME_SIZE);
+    HeapMemory_setOwner(owner);
+    Debug_assert(stack != NULL);
+    self->kernelStackBase = stack;
+    self->kernelStack = (char*) stack + FRAME_SIZE;
+
+    ProcessManager_initUserStack(self);
+
+    return self;
+
+}
+
+PRIVATE Process* ProcessManager_newProcess(void) {
+
+    Process* self = NULL;
+
+#ifdef BENCHMARK
+    spawnBypassPool = !spawnBypassPool;
+    spawnPooled = processPool.size > 0 && !spawnBypassPool;
+
+    if(spawnPooled)
+        self = Stack_pop(&processPool);
+#else
+    if(processPool.size > 0)
+        self = Stack_pop(&processPool);
+#endif
+
+    if(self == NULL)
+        self = ProcessManager_newAddressSpace();
+
+    self->pid = pid;
+    self->userHeapTop = (void*) USER_HEAP_BASE_VADDR;
+
+    /* Charged to the new process, not to the one calling spawn */
+    u32int owner = HeapMemory_setOwner(self->pid);
+    self->fileNodes = ArrayList_new(1);
+    HeapMemory_setOwner(owner);
+
+    ArrayList_add(processes, self);
+
     pid++;
     self->status = PROCESS_CREATED;
 
@@ -128,7 +184,7 @@ PRIVATE Process* ProcessManager_newProcess(void) {
 PRIVATE void ProcessManager_initKernelProcess(void) {
 
     extern void Kernel_idle(void); /* Defined in Kernel.c */
-    kernelProcess = HeapMemory_calloc(1, sizeof(Process));
+    kernelProcess = Slab_alloc(processCache);
     Debug_assert(kernelProcess != NULL);
 
     kernelProcess->pid = 0;
@@ -157,8 +213,8 @@ PRIVATE void ProcessManager_initKernelProcess(void) {
     /* Set page directory */
     kernelProcess->pageDir = VirtualMemory_getKernelDir();
 
-    /* Allocate kernel stack - 4KB */
-    u32int* stack = HeapMemory_calloc(1, FRAME_SIZE);
+    /* Allocate kernel stack - 4KB, no need to zero it */
+    u32int* stack = HeapMemory_alloc(FRAME_SIZE);
     Debug_assert(stack != NULL);
     kernelProcess->kernelStackBase = stack;
     kernelProcess->kernelStack = (char*) stack + FRAME_SIZE - sizeof(Regs);
@@ -170,8 +226,6 @@ PRIVATE void ProcessManager_initKernelProcess(void) {
 
 PRIVATE void ProcessManager_destroyProcess(Process* process) {
 
-    HeapMemory_free(process->kernelStackBase);
-
     /* close all opened files */
     for(u32int i = 0; i < ArrayList_getSize(process->fileNodes); i++) {
 
@@ -181,8 +235,30 @@ PRIVATE void ProcessManager_destroyProcess(Process* process) {
     }
 
     ArrayList_destroy(process->fileNodes);
+
+    ArenaMark empty = {NULL, 0};
+    Arena_reset(&process->scratch, empty);
+
+    if(processPool.size < PROCESS_POOL_SIZE) { /* Recycle the address space, only user memory is given back */
+
+        void* pageDir = process->pageDir;
+        void* kernelStackBase = process->kernelStackBase;
+
+        VirtualMemory_resetPageDirectory(process);
+        Memory_set(process, 0, sizeof(Process));
+        process->pageDir = pageDir;
+        process->kernelStackBase = kernelStackBase;
+        process->kernelStack = (char*) kernelStackBase + FRAME_SIZE;
+
+        ProcessManager_initUserStack(process);
+        Stack_push(&processPool, process);
+        return;
+
+    }
+
+    HeapMemory_free(process->kernelStackBase);
     VirtualMemory_destroyPageDirectory(process);
-    HeapMemory_free(process);
+    Slab_free(processCache, process);
 
 }
 
@@ -198,7 +274,7 @@ PRIVATE void ProcessManager_notify(void) {
                 m->from->status = PROCESS_WAITING;
 
             ArrayList_remove(globalMailbox, m);
-            HeapMemory_free(m);
+            Slab_free(messageCache, m);
 
         }
 
@@ -220,6 +296,11 @@ PRIVATE void ProcessManager_init(void) {
     pid = 1; /* User process pids are >= 1 */
     Scheduler_init();
     globalMailbox = ArrayList_new(10);
+    processes = ArrayList_new(10);
+    reaperQueue = ArrayList_new(10);
+    processCache = Slab_createCache("Process", sizeof(Process), 0);
+    messageCache = Slab_createCache("Message", sizeof(Message), 0);
+    Stack_init(&processPool, processPoolEntries, sizeof(processPoolEntries));
     ProcessManager_initKernelProcess();
 
 }
@@ -236,9 +317,10 @@ PUBLIC void ProcessManager_switch(Regs* context) {
 
     } else { /* Switching from a user process */
 
-        if(currentProcess->status == PROCESS_TERMINATED) { /* Switching from a *killed* user process, free resources */
+        if(currentProcess->status == PROCESS_TERMINATED) { /* Switching from a *killed* user process, the idle process frees resources */
 
-            ProcessManager_destroyProcess(currentProcess);
+            ArrayList_remove(processes, currentProcess);
+            ArrayList_add(reaperQueue, currentProcess);
 
         } else {
 
@@ -268,9 +350,13 @@ PUBLIC void ProcessManager_switch(Regs* context) {
 
     Debug_assert(next->status == PROCESS_WAITING);
     next->status = PROCESS_RUNNING;
-    if(currentProcess == next) /* No need for a context switch */
+    if(currentProcess == next) { /* No need for a context switch, clear the ESP left from the last one */
+
+        asm volatile("mov %0, %%DR0" : : "a" (0));
         return;
 
+    }
+
 
     Debug_assert(next->kernelStack != NULL);
 
@@ -289,6 +375,16 @@ PUBLIC void ProcessManager_switch(Regs* context) {
 
     VirtualMemory_switchPageDir(next->pageDir); /* Switch to next process' address space */
 
+#ifdef BENCHMARK
+    if(next == spawnMeasured) { /* First switch to a spawned process, it runs its first instruction next */
+
+        u32int cycles = (u32int) (CPU_readTimestamp() - spawnBegin);
+        Console_printf("%s%s%s%d%s", "[BENCH] Spawn latency, ", spawnPooled ? "pooled" : "built", ": ", cycles, " cycles\n");
+        spawnMeasured = NULL;
+
+    }
+#endif
+
 }
 
 PUBLIC void ProcessManager_killProcess(int exitCode) {
@@ -299,6 +395,7 @@ PUBLIC void ProcessManager_killProcess(int exitCode) {
     Debug_assert(current != NULL);
     Debug_assert(current != kernelProcess); /* Can't kill kernel process */
     Debug_logInfo("%s%d%c%s%s%d", "PID:", current->pid, ' ', current->name, " exited with code ", exitCode);
+    Debug_logInfo("%s%d%s%d%s%d", "PID:", current->pid, " zero page faults: ", current->zeroFaults, ", private page faults: ", current->privateFaults);
 
     ProcessManager_notify();
     Scheduler_removeProcess(current);
@@ -310,44 +407,140 @@ PUBLIC void ProcessManager_killProcess(int exitCode) {
 
 PUBLIC Process* ProcessManager_spawnProcess(const char* binary) {
 
+#ifdef BENCHMARK
+    spawnBegin = CPU_readTimestamp();
+#endif
+
     VFSNode* bin = VFS_openFile(binary, "r");
     if(bin == NULL) /* Couldn't open the file */
         return NULL;
 
-    char* buffer = HeapMemory_calloc(1, bin->fileSize + 1);
-    Debug_assert(buffer != NULL);
-    VFS_read(bin, 0, bin->fileSize, buffer);
-
     Process* p = ProcessManager_newProcess();
+    Debug_assert(p != NULL);
     p->workingDirectory = VFS_getParent(bin);
     String_copy(p->name, bin->fileName); /* Set process name */
-    Debug_assert(p != NULL);
 
-    u32int i;
+    /* Nothing is copied here, code pages are read from the image on first access(see VirtualMemory.c) */
+    p->image = bin;
+    p->codePages = (bin->fileSize / FRAME_SIZE) + 1;
 
-    /* VirtualMemory_mapPage uses TEMPORARY_MAP_VADDR and TEMPORARY_MAP_VADDR + 0x1000 */
-    /* This could interfere with our VirtualMemory_quickMap, so use a higher temporary map address */
-    u32int tempMapAddr = TEMPORARY_MAP_VADDR + (2 * FRAME_SIZE);
+    VFS_closeFile(bin);
+    Scheduler_addProcess(p);
 
-    /* Copy user code from kernel heap to user space */
-    for(i = 0; i < (bin->fileSize / FRAME_SIZE) + 1; i++) {
+#ifdef BENCHMARK
+    spawnMeasured = p;
+#endif
 
-        void* phys = PhysicalMemory_allocateFrame();
-        VirtualMemory_mapPage(p->pageDir, (void*) (USER_CODE_BASE_VADDR + (i * FRAME_SIZE)), phys, MODE_USER);
-        VirtualMemory_quickMap((void*) (tempMapAddr + (i * FRAME_SIZE)), phys);
+    return p;
+
+}
+
+PUBLIC Process* ProcessManager_fork(Regs* regs) {
+
+    Process* parent = Scheduler_getCurrentProcess();
+    Debug_assert(parent != NULL && parent != kernelProcess);
+
+    Process* self = Slab_alloc(processCache);
+    Debug_assert(self != NULL);
+
+    self->pid = pid;
+    u32int owner = HeapMemory_setOwner(self->pid); /* Charged to the child, not to the parent making the call */
+
+    self->userHeapTop = parent->userHeapTop;
+    self->userStackBase = parent->userStackBase;
+    self->workingDirectory = parent->workingDirectory;
+    self->image = parent->image;
+    self->codePages = parent->codePages;
+    self->nice = parent->nice;
+    self->fileNodes = ArrayList_new(1); /* Open files are not inherited */
+    String_copy(self->name, parent->name);
+
+    VirtualMemory_createPageDirectory(self);
+    ArrayList_add(processes, self);
+
+    /* Allocate kernel stack - 4KB, no need to zero it. It stays with the address space when that is pooled */
+    HeapMemory_setOwner(HEAP_OWNER_KERNEL);
+    u32int* stack = HeapMemory_alloc(FRAME_SIZE);
+    HeapMemory_setOwner(self->pid);
+    Debug_assert(stack != NULL);
+    self->kernelStackBase = stack;
+    self->kernelStack = (char*) stack + FRAME_SIZE;
+
+    /* Share every user page with the parent, copied on write */
+    VirtualMemory_cloneAddressSpace(self);
+    HeapMemory_setOwner(owner);
+
+    /* Child resumes right after the syscall, with a return value of 0 */
+    self->userStack = (char*) self->kernelStack - sizeof(Regs);
+    Memory_copy(self->userStack, regs, sizeof(Regs));
+    ((Regs*) self->userStack)->eax = 0;
+    ((Regs*) self->userStack)->intNo = IRQ0;
+
+    pid++;
+    self->status = PROCESS_CREATED;
+    Scheduler_addProcess(self);
+
+    return self;
+
+}
+
+PUBLIC bool ProcessManager_reap(void) {
+
+    /* Heap and the temporary mappings are shared with syscalls and IRQs, tear down with interrupts off */
+    Sys_disableInterrupts();
+
+    if(ArrayList_isEmpty(reaperQueue)) {
+
+        Sys_enableInterrupts();
+        return FALSE;
 
     }
 
-    Memory_copy((void*) tempMapAddr, buffer, bin->fileSize);
+    Process* process = ArrayList_get(reaperQueue, 0);
 
-    for(u32int y = 0; y < i; y++)
-        VirtualMemory_quickUnmap((void*) (tempMapAddr + (y * FRAME_SIZE)));
+    /* One page table per call so that interrupts get in between, the rest goes once user memory is gone */
+    if(!VirtualMemory_releaseUserTable(process)) {
 
-    HeapMemory_free(buffer);
-    VFS_closeFile(bin);
-    Scheduler_addProcess(p);
+        u32int pid = process->pid;
+        ArrayList_removeAt(reaperQueue, 0);
+        ProcessManager_destroyProcess(process);
+        HeapMemory_reportLeaks(pid); /* Whatever it still owns now was never freed */
 
-    return p;
+    }
+
+    Sys_enableInterrupts();
+
+    return TRUE;
+
+}
+
+PUBLIC bool ProcessManager_refillPool(void) {
+
+    PhysicalMemoryInfo info;
+
+    /* Heap and the temporary mappings are shared with syscalls and IRQs, build with interrupts off */
+    Sys_disableInterrupts();
+
+    if(processPool.size == PROCESS_POOL_SIZE || PhysicalMemory_getInfo(&info)->freeFrames < PROCESS_POOL_MIN_FREE) {
+
+        Sys_enableInterrupts();
+        return FALSE;
+
+    }
+
+    Stack_push(&processPool, ProcessManager_newAddressSpace());
+    Sys_enableInterrupts();
+
+    return TRUE;
+
+}
+
+PUBLIC Process* ProcessManager_getProcess(u32int index) {
+
+    if(processes == NULL || index >= ArrayList_getSize(processes))
+        return NULL;
+
+    return ArrayList_get(processes, index);
 
 }
 
@@ -362,7 +555,7 @@ PUBLIC void ProcessManager_waitPID(Process* process) {
 
     Debug_assert(process != NULL);
 
-    Message* m = HeapMemory_calloc(1, sizeof(Message));
+    Message* m = Slab_alloc(messageCache);
 
     /* Set current process as waiting for parameter process' termination */
     m->from = Scheduler_getCurrentProcess();
@@ -373,6 +566,24 @@ PUBLIC void ProcessManager_waitPID(Process* process) {
 
 }
 
+PUBLIC int ProcessManager_nice(int increment) {
+
+    Process* current = Scheduler_getCurrentProcess();
+    Debug_assert(current != NULL && current != kernelProcess);
+
+    int nice = (int) current->nice + increment;
+
+    if(nice < 0)
+        nice = 0;
+    else if(nice > PROCESS_NICE_MAX)
+        nice = PROCESS_NICE_MAX;
+
+    current->nice = nice; /* Scheduler applies it when the process is switched out */
+
+    return nice;
+
+}
+
 PUBLIC Module* ProcessManager_getModule(void) {
 
     if(!pmModule.isLoaded) {
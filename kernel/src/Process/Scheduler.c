@@ -16,14 +16,26 @@
 #include <Process/Scheduler.h>
 #include <Debug.h>
 
-/* Include scheduler implementation */
+/* Include scheduler implementation, MLFQ unless SCHEDULER_ROUND_ROBIN is defined */
 /* #include <Process/FCFS.h> */
+#ifdef SCHEDULER_ROUND_ROBIN
 #include <Process/RoundRobin.h>
+#else
+#include <Process/MLFQ.h>
+#endif
+
+/*=======================================================
+    DEFINE
+=========================================================*/
+#define FIXED_QUANTUM 2 /* Ticks, for schedulers without a quantum of their own */
 
 /*=======================================================
     PRIVATE DATA
 =========================================================*/
 PRIVATE bool isPreemptive;
+#ifdef SCHEDULER_ROUND_ROBIN
+PRIVATE u32int ticks; /* See Scheduler_fixedQuantum */
+#endif
 
 /*=======================================================
     PUBLIC DATA
@@ -32,20 +44,47 @@ PUBLIC void (*Scheduler_addProcess) (Process* process);
 PUBLIC void (*Scheduler_removeProcess) (Process* process);
 PUBLIC Process* (*Scheduler_getNextProcess) (void);
 PUBLIC Process* (*Scheduler_getCurrentProcess) (void);
+PUBLIC bool (*Scheduler_tick) (void);
+PUBLIC void (*Scheduler_boostProcess) (Process* process);
 
 /*=======================================================
     FUNCTION
 =========================================================*/
 
+#ifdef SCHEDULER_ROUND_ROBIN
+PRIVATE bool Scheduler_fixedQuantum(void) {
+
+    return ++ticks % FIXED_QUANTUM == 0;
+
+}
+
+PRIVATE void Scheduler_noBoost(Process* process) {
+
+    UNUSED(process);
+
+}
+#endif
+
 PUBLIC void Scheduler_init(void) {
 
     Debug_logInfo("%s", "Initialising Scheduler");
 
     /* Point to scheduler implementation */
+#ifdef SCHEDULER_ROUND_ROBIN
     Scheduler_addProcess        = &RoundRobin_addProcess;
     Scheduler_removeProcess     = &RoundRobin_removeProcess;
     Scheduler_getNextProcess    = &RoundRobin_getNextProcess;
     Scheduler_getCurrentProcess = &RoundRobin_getCurrentProcess;
+    Scheduler_tick              = &Scheduler_fixedQuantum;
+    Scheduler_boostProcess      = &Scheduler_noBoost;
+#else
+    Scheduler_addProcess        = &MLFQ_addProcess;
+    Scheduler_removeProcess     = &MLFQ_removeProcess;
+    Scheduler_getNextProcess    = &MLFQ_getNextProcess;
+    Scheduler_getCurrentProcess = &MLFQ_getCurrentProcess;
+    Scheduler_tick              = &MLFQ_tick;
+    Scheduler_boostProcess      = &MLFQ_boostProcess;
+#endif
 
     /* Is this scheduler implementation preemptive or not */
     isPreemptive = TRUE;
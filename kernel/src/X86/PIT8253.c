@@ -29,6 +29,7 @@
 #include <X86/IDT.h>
 #include <X86/PIC8259.h>
 #include <Process/ProcessManager.h>
+#include <Process/Scheduler.h>
 #include <Sys.h>
 #include <Debug.h>
 
@@ -116,7 +117,7 @@ PRIVATE void PIT8253_timerHandler(Regs* regs) {
      /* Do context switch only if the process management module is loaded */
     if(ProcessManager_getModule()->isLoaded) {
 
-      if(tick % 2 == 0) /* context switch every 20ms */
+      if(Scheduler_tick()) /* context switch when the scheduler says so, every 20ms with a fixed quantum */
           ProcessManager_switch(regs);
       else /* Set DR0(stores process ESP) to NULL if we don't call the scheduler */
           asm volatile("mov %0, %%DR0" : : "a" (0));
@@ -23,18 +23,22 @@
 #include <Memory/VirtualMemory.h>
 #include <Memory/PhysicalMemory.h>
 #include <Memory/HeapMemory.h>
+#include <Memory/Arena.h>
 #include <Drivers/Keyboard.h>
 
 /*=======================================================
     DEFINE
 =========================================================*/
 #define SYSCALL_INTERRUPT   0x80
-#define NUMBER_OF_CALLS       24
+#define NUMBER_OF_CALLS       30
 
 /*=======================================================
     PRIVATE DATA
 =========================================================*/
 PRIVATE Module userModule;
+PRIVATE Regs*  syscallRegs; /* State of the process making the current call */
+
+PRIVATE Process* Usermode_fork(void);
 
 PRIVATE void* syscalls[NUMBER_OF_CALLS] = {
 
@@ -62,6 +66,12 @@ PRIVATE void* syscalls[NUMBER_OF_CALLS] = {
     &Console_setColor,
     &Sys_powerOff,
     &ProcessManager_waitPID,
+    &Usermode_fork,
+    &VirtualMemory_mmap,
+    &VirtualMemory_munmap,
+    &HeapMemory_printProfile,
+    &ProcessManager_nice,
+    &PhysicalMemory_printInfo,
 
 };
 
@@ -69,12 +79,23 @@ PRIVATE void* syscalls[NUMBER_OF_CALLS] = {
     FUNCTION
 =========================================================*/
 
+PRIVATE Process* Usermode_fork(void) {
+
+    return ProcessManager_fork(syscallRegs);
+
+}
+
 PRIVATE void Usermode_syscallHandler(Regs* regs) {
 
     /* Valid call request? */
     Debug_assert(regs->eax < NUMBER_OF_CALLS);
 
     int ret = 0;
+    syscallRegs = regs;
+
+    /* Scratch buffers of the call are freed on return, the call may block so each process has its own arena */
+    Arena* scratch = Arena_getScratch();
+    ArenaMark mark = Arena_begin(scratch);
 
     asm volatile("\
         push %1;   \
@@ -91,6 +112,7 @@ PRIVATE void Usermode_syscallHandler(Regs* regs) {
     " : "=a" (ret) : "r" (regs->edi), "r" (regs->esi), "r" (regs->edx), "r" (regs->ecx), "r" (regs->ebx), "r" (syscalls[regs->eax]));
 
     regs->eax = ret; /* Store return value in eax */
+    Arena_reset(scratch, mark);
 
 }
 
@@ -14,6 +14,12 @@ fi
 
 # Define C compiler flags
 # Append '-D NO_DEBUG' if you want to disable assertions and debug messages
+# Append '-D BENCHMARK' if you want to run kernel benchmarks at boot
+# Append '-D STACK_PMM_EAGER' if you want StackPMM to push every frame at boot(old behaviour)
+# Append '-D VMM_LARGE_IDENTITY' if you want the first 4MB identity mapped with a 4MB page(page 0 is then mapped, NULL accesses don't fault)
+# Append '-D HEAP_PROFILE' if you want kernel heap allocations profiled(see 'heap' shell command)
+# Append '-D HEAP_TLSF' if you want the TLSF kernel heap manager(bounded time malloc/free) instead of DougLea
+# Append '-D SCHEDULER_ROUND_ROBIN' if you want the round robin scheduler(fixed 20ms quantum) instead of MLFQ
 CFlags="-nostdlib -fno-builtin -fno-stack-protector -O0 -Wall -Wextra -Werror -std=gnu99 -I kernel/include/ -I user/include"
 
 #------ User Space ------
@@ -38,8 +44,30 @@ $Linker -T user/src/Apps/apps.ld -o InputTest   inputtest.o  bin/libIncitatus.a
 $Linker -T user/src/Apps/apps.ld -o Calculator  calc.o       bin/libIncitatus.a
 
 # Add user space application binaries to the ramdisk(tar archive)
-tar --delete --file bootloader/initrd.tar Shell HelloWorld InputTest Calculator
-tar --append --file bootloader/initrd.tar Shell HelloWorld InputTest Calculator
+# Each binary is preceded by a '.pad' entry so that its data starts on a 4KB
+# boundary, the kernel then maps it into processes without copying(see RamDisk.c)
+tar --delete --file bootloader/initrd.tar .pad Shell HelloWorld InputTest Calculator 2> /dev/null
+
+for binary in Shell HelloWorld InputTest Calculator; do
+
+    # Offset of the next header = sum of every entry(512 byte header + data rounded up to 512)
+    offset=0
+    for size in $(tar --list --verbose --file bootloader/initrd.tar | awk '{print $3}'); do
+        offset=$((offset + 512 + (size + 511) / 512 * 512))
+    done
+
+    # Data follows the header, padding entry needs at least 512 bytes for its own header
+    padding=$(( (4096 - (offset + 512) % 4096) % 4096 ))
+
+    if [ $padding -ne 0 ]; then
+        head -c $((padding - 512)) /dev/zero > .pad
+        tar --append --file bootloader/initrd.tar .pad
+        rm .pad
+    fi
+
+    tar --append --file bootloader/initrd.tar $binary
+
+done
 
 # Clear
 rm Shell
@@ -57,6 +85,7 @@ nasm -f elf -o idtAsm.o  kernel/src/X86/IDT.s
 $C_Compiler $CFlags -o kernel.o  -c   kernel/src/Kernel.c
 $C_Compiler $CFlags -o sys.o     -c   kernel/src/Sys.c
 $C_Compiler $CFlags -o module.o  -c   kernel/src/Module.c
+$C_Compiler $CFlags -o bench.o   -c   kernel/src/Benchmark.c
 
 $C_Compiler $CFlags -o vga.o     -c   kernel/src/Drivers/VGA.c
 $C_Compiler $CFlags -o console.o -c   kernel/src/Drivers/Console.c
@@ -78,18 +107,25 @@ $C_Compiler $CFlags -o arrlist.o -c   kernel/src/Lib/ArrayList.c
 $C_Compiler $CFlags -o linkl.o   -c   kernel/src/Lib/LinkedList.c
 $C_Compiler $CFlags -o string.o  -c   kernel/src/Lib/String.c
 $C_Compiler $CFlags -o fifo.o    -c   kernel/src/Lib/CircularFIFOBuffer.c
+$C_Compiler $CFlags -o lz.o      -c   kernel/src/Lib/LZ.c
 
 $C_Compiler $CFlags -o pmm.o     -c   kernel/src/Memory/PhysicalMemory.c
 $C_Compiler $CFlags -o smm.o     -c   kernel/src/Memory/StackPMM.c
 $C_Compiler $CFlags -o bmm.o     -c   kernel/src/Memory/BitmapPMM.c
+$C_Compiler $CFlags -o buddy.o   -c   kernel/src/Memory/BuddyPMM.c
 $C_Compiler $CFlags -o vmm.o     -c   kernel/src/Memory/VirtualMemory.c
 $C_Compiler $CFlags -o heap.o    -c   kernel/src/Memory/HeapMemory.c
 $C_Compiler $CFlags -o dl.o      -c   kernel/src/Memory/DougLea.c
 $C_Compiler $CFlags -o dumbH.o   -c   kernel/src/Memory/DumbHeapManager.c
+$C_Compiler $CFlags -o tlsf.o    -c   kernel/src/Memory/TLSF.c
+$C_Compiler $CFlags -o swap.o    -c   kernel/src/Memory/Swap.c
+$C_Compiler $CFlags -o slab.o    -c   kernel/src/Memory/Slab.c
+$C_Compiler $CFlags -o arena.o   -c   kernel/src/Memory/Arena.c
 
 $C_Compiler $CFlags -o sched.o   -c   kernel/src/Process/Scheduler.c
 $C_Compiler $CFlags -o rr.o      -c   kernel/src/Process/RoundRobin.c
 $C_Compiler $CFlags -o fcfs.o    -c   kernel/src/Process/FCFS.c
+$C_Compiler $CFlags -o mlfq.o    -c   kernel/src/Process/MLFQ.c
 $C_Compiler $CFlags -o pm.o      -c   kernel/src/Process/ProcessManager.c
 
 $C_Compiler $CFlags -o ramdisk.o -c   kernel/src/FileSystem/RamDisk.c
@@ -103,6 +139,7 @@ $Linker -Map bin/Mem.map -T kernel/src/Linker.ld -o bootloader/kernel   start.o
                                                                         console.o \
                                                                         sys.o \
                                                                         module.o \
+                                                                        bench.o \
                                                                         gdt.o \
                                                                         pic.o \
                                                                         idt.o \
@@ -115,17 +152,24 @@ $Linker -Map bin/Mem.map -T kernel/src/Linker.ld -o bootloader/kernel   start.o
                                                                         pmm.o \
                                                                         smm.o \
                                                                         bmm.o \
+                                                                        buddy.o \
                                                                         vmm.o \
                                                                         heap.o \
                                                                         dl.o \
                                                                         arrlist.o \
                                                                         dumbH.o \
+                                                                        tlsf.o \
                                                                         linkl.o \
                                                                         string.o \
                                                                         fifo.o \
+                                                                        lz.o \
+                                                                        swap.o \
+                                                                        slab.o \
+                                                                        arena.o \
                                                                         sched.o \
                                                                         rr.o \
                                                                         fcfs.o \
+                                                                        mlfq.o \
                                                                         pm.o \
                                                                         kbd.o \
                                                                         mouse.o \
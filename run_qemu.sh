@@ -1,8 +1,9 @@
 #!/bin/sh
 
+# Override the amount of RAM(MB) with e.g. 'QEMU_MEMORY=3500 ./run_qemu.sh'
 qemu-system-i386         \
     -net none            \
-    -m 4                 \
+    -m ${QEMU_MEMORY:-4} \
     -cdrom bin/image.iso \
     -monitor stdio       \
     #-s                  \
@@ -62,6 +62,12 @@ struct stat {
 #define SYSCALL_SETCOLOR    21
 #define SYSCALL_POWEROFF    22
 #define SYSCALL_WAITPID     23
+#define SYSCALL_FORK        24
+#define SYSCALL_MMAP        25
+#define SYSCALL_MUNMAP      26
+#define SYSCALL_HEAPSTAT    27
+#define SYSCALL_NICE        28
+#define SYSCALL_MEMSTAT     29
 
 #define FILE int
 
@@ -92,4 +98,10 @@ FILE* mkdir(const char* pathname);
 void* sbrk(int size);
 void color(unsigned int attr);
 void waitpid(int pid);
+int fork(void);
+void* mmap(void* addr, unsigned int length, FILE* file, unsigned int offset);
+int munmap(void* addr, unsigned int length);
+void heapstat(void);
+int nice(int increment);
+void memstat(void);
 #endif
\ No newline at end of file
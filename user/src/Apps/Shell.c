@@ -130,6 +130,14 @@ static void parseInput(char* in) {
         poweroff();
         suicide(); /* panic if not successful */
 
+    } else if(strcmp(command, "heap") == 0) { /* kernel heap profile */
+
+        heapstat();
+
+    } else if(strcmp(command, "mem") == 0) { /* physical memory and zero pool stats */
+
+        memstat();
+
     } else if(strcmp(command, "help") == 0) { /* list valid commands */
 
         help();
@@ -164,9 +172,34 @@ static void cat(const char* path) {
 
     struct stat fileStat;
     fstat(file, &fileStat);
-    char buf[fileStat.fileSize + 1];
-    read(file, 0, fileStat.fileSize, buf);
-    printf("%s%c", buf, '\n');
+
+    if(fileStat.fileSize == 0) {
+        close(file);
+        putc('\n');
+        return;
+    }
+
+    /* Map the file instead of copying all of it, print it in null terminated chunks */
+    const char* data = mmap(NULL, fileStat.fileSize, file, 0);
+    char chunk[128];
+
+    if(data == NULL) {
+        puts("Couldn't map that file\n");
+        close(file);
+        return;
+    }
+
+    for(unsigned int i = 0; i < fileStat.fileSize; i += sizeof(chunk) - 1) {
+
+        unsigned int count = fileStat.fileSize - i < sizeof(chunk) - 1 ? fileStat.fileSize - i : sizeof(chunk) - 1;
+        memcpy(chunk, data + i, count);
+        chunk[count] = '\0';
+        puts(chunk);
+
+    }
+
+    putc('\n');
+    munmap((void*) data, fileStat.fileSize);
     close(file);
 
 }
@@ -197,6 +230,8 @@ static void help(void) {
         "cat [file] - display file contents\n"
         "restart - restart machine\n"
         "exec [file] - execute binary file\n"
+        "heap - slab caches and kernel heap profile(profile needs HEAP_PROFILE)\n"
+        "mem - free frames and pre-zeroed pool hits/misses\n"
         "suicide - kills the shell\n"
         "shutdown - shuts down the machine\n"
         );
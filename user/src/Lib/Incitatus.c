@@ -167,4 +167,40 @@ void waitpid(int pid) {
     syscall(SYSCALL_WAITPID, pid, 0, 0, 0, 0);
     for(int i = 0; i < 5000000; i++); /* FIX: race condition */
 
+}
+
+int fork(void) {
+
+    return syscall(SYSCALL_FORK, 0, 0, 0, 0, 0);
+
+}
+
+void* mmap(void* addr, unsigned int length, FILE* file, unsigned int offset) {
+
+    return (void*) syscall(SYSCALL_MMAP, (int) addr, length, (int) file, offset, 0);
+
+}
+
+int munmap(void* addr, unsigned int length) {
+
+    return syscall(SYSCALL_MUNMAP, (int) addr, length, 0, 0, 0) ? 0 : -1;
+
+}
+
+void heapstat(void) {
+
+    syscall(SYSCALL_HEAPSTAT, 0, 0, 0, 0, 0);
+
+}
+
+int nice(int increment) {
+
+    return syscall(SYSCALL_NICE, increment, 0, 0, 0, 0);
+
+}
+
+void memstat(void) {
+
+    syscall(SYSCALL_MEMSTAT, 0, 0, 0, 0, 0);
+
 }
\ No newline at end of file